@@ -0,0 +1,169 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "Common.hpp" // IWYU pragma: keep
+
+#include <iomanip>
+#include <iostream>
+
+#include "ElementScript.hpp"
+#include "Replay.hpp"
+
+// headless benchmark: runs the standard scenarios or a recorded replay without a window and reports
+// ticks per second, the average time of each update phase and a hash of the final grid
+// usage: FallingPixels_bench [ticks] [scenario]
+//        FallingPixels_bench replay <file>
+
+struct scenario final {
+    std::string                                            Name;
+    std::function<void(element_system&, world_def const&)> Setup;
+};
+
+static auto make_scenarios() -> std::vector<scenario>
+{
+    return {
+        {"sand_avalanche", [](element_system& system, world_def const& world) {
+             size_i const size {system.size()};
+             for (i32 x {0}; x < size.Width / 2; ++x) { // ramp down to the right
+                 system.fill({x, (size.Height / 2) + x, 1, (size.Height / 2) - x}, world.find_element("Stone"));
+             }
+             system.fill({0, 0, size.Width / 2, size.Height / 3}, world.find_element("Sand"));
+         }},
+        {"water_flood", [](element_system& system, world_def const& world) {
+             size_i const size {system.size()};
+             system.fill({0, 0, size.Width / 4, size.Height}, world.find_element("Water"));
+         }},
+        {"fire_wood", [](element_system& system, world_def const& world) {
+             size_i const size {system.size()};
+             system.fill({0, size.Height / 2, size.Width, size.Height / 2}, world.find_element("Wood"));
+             system.fill({0, size.Height - 2, size.Width, 2}, world.find_element("Fire"));
+         }},
+        {"lava_ice", [](element_system& system, world_def const& world) {
+             size_i const size {system.size()};
+             system.fill({0, size.Height / 2, size.Width, size.Height / 2}, world.find_element("Ice"));
+             system.fill({size.Width / 4, 0, size.Width / 2, size.Height / 4}, world.find_element("Lava"));
+         }},
+    };
+}
+
+// runs the system for the given number of ticks and prints one result row
+static void run(std::string const& name, element_system& system, u64 ticks, std::function<void()> const& beforeTick)
+{
+    using clock = std::chrono::steady_clock;
+
+    update_stats total;
+    f64          tempImbalance {0}, gridImbalance {0};
+    i32          tempTicks {0}, gridTicks {0};
+    auto const   start {clock::now()};
+    for (u64 i {0}; i < ticks; ++i) {
+        if (beforeTick) { beforeTick(); }
+        system.update();
+        auto const& stats {system.last_update()};
+        total.ResetMoved += stats.ResetMoved;
+        total.Chunks += stats.Chunks;
+        total.Temperature += stats.Temperature;
+        total.Grid += stats.Grid;
+        total.Particles += stats.Particles;
+        total.DirtyRects += stats.DirtyRects;
+        if (auto const& temp {stats.Workers[static_cast<usize>(parallel_pass::Temperature)]}; temp.Workers > 0) {
+            tempImbalance += temp.imbalance();
+            ++tempTicks;
+        }
+        if (auto const& grid {stats.Workers[static_cast<usize>(parallel_pass::Grid)]}; grid.Workers > 0) {
+            gridImbalance += grid.imbalance();
+            ++gridTicks;
+        }
+    }
+    f64 const seconds {std::chrono::duration<f64> {clock::now() - start}.count()};
+    f64 const count {static_cast<f64>(std::max<u64>(ticks, 1))};
+
+    // per-phase columns are average milliseconds per tick, imbal columns are slowest worker / average worker of that pass
+    std::cout << std::fixed << std::setprecision(3)
+              << std::left << std::setw(16) << name << std::right
+              << std::setw(12) << std::setprecision(1) << (count / seconds) << std::setprecision(3)
+              << std::setw(10) << total.ResetMoved.count() / count
+              << std::setw(10) << total.Chunks.count() / count
+              << std::setw(10) << total.Temperature.count() / count
+              << std::setw(10) << total.Grid.count() / count
+              << std::setw(10) << total.Particles.count() / count
+              << std::setw(10) << total.DirtyRects.count() / count
+              << std::setw(10) << (tempTicks > 0 ? tempImbalance / tempTicks : 0.0)
+              << std::setw(10) << (gridTicks > 0 ? gridImbalance / gridTicks : 0.0)
+              << "  " << std::hex << std::setw(16) << std::setfill('0') << system.hash() << std::dec << std::setfill(' ') << "\n";
+}
+
+static void print_header(size_i gridSize, u64 seed, u64 ticks)
+{
+    std::cout << "grid: " << gridSize.Width << "x" << gridSize.Height << " seed: " << seed << " ticks: " << ticks << "\n";
+    std::cout << std::left << std::setw(16) << "scenario" << std::right
+              << std::setw(12) << "ticks/s"
+              << std::setw(10) << "reset"
+              << std::setw(10) << "chunks"
+              << std::setw(10) << "temp"
+              << std::setw(10) << "grid"
+              << std::setw(10) << "particles"
+              << std::setw(10) << "dirty"
+              << std::setw(10) << "temp imb"
+              << std::setw(10) << "grid imb"
+              << "  hash\n";
+}
+
+static auto run_replay(world_def const& world, path const& file) -> int
+{
+    replay rep;
+    {
+        io::ifstream stream {file};
+        if (!rep.load(stream)) {
+            std::cerr << file << " is not a replay\n";
+            return 1;
+        }
+    }
+
+    element_system system {world.Elements, rep.GridSize, rep.Seed};
+    replay_player  player;
+    if (!player.start(system, rep)) {
+        std::cerr << "grid size or elements of " << file << " do not match\n";
+        return 1;
+    }
+
+    print_header(system.size(), rep.Seed, rep.Ticks);
+    run("replay", system, rep.Ticks, [&]() { player.step(system); });
+    player.step(system); // events recorded after the last tick
+
+    std::cout << (player.matched() ? "replay matched the recording\n" : "replay diverged from the recording\n");
+    return player.matched() ? 0 : 2;
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+    auto pl {platform::HeadlessInit()};
+
+    world_def const world {load_elements("elements.lua").value_or(world_def {})};
+    if (world.Elements.empty()) {
+        std::cerr << "elements.lua not found, empty or broken\n";
+        return 1;
+    }
+
+    if (argc > 2 && std::string {argv[1]} == "replay") { return run_replay(world, argv[2]); }
+
+    i32 const         ticks {argc > 1 ? std::max(1, std::atoi(argv[1])) : 1000};
+    std::string const filter {argc > 2 ? argv[2] : ""};
+
+    bool printedHeader {false};
+    for (auto const& sc : make_scenarios()) {
+        if (!filter.empty() && sc.Name != filter) { continue; }
+
+        element_system system {world.Elements, world.GridSize, world.Seed};
+        if (!printedHeader) {
+            // the grid is rounded up to whole chunks, so the script's size isn't the one that runs
+            print_header(system.size(), world.Seed, static_cast<u64>(ticks));
+            printedHeader = true;
+        }
+        sc.Setup(system, world);
+        run(sc.Name, system, static_cast<u64>(ticks), {});
+    }
+
+    return 0;
+}
@@ -10,6 +10,13 @@
 using namespace tcob;
 using namespace tcob::scripting;
 
-constexpr size_i GRID_SIZE {512, 512};
+constexpr size_i DEFAULT_GRID_SIZE {512, 512};
+constexpr size_i MAX_GRID_SIZE {4096, 4096};
+constexpr u64    DEFAULT_WORLD_SEED {12345};
+constexpr i32    CHUNK_SIZE {32};
+constexpr i32    MAX_FALL_SPEED {8};         // in steps of an element's gravity per tick
+constexpr f32    PARTICLE_GRAVITY {0.25f};   // cells per tick squared
+constexpr f32    MAX_PARTICLE_SPEED {16.0f}; // cells per tick
+constexpr i32    PARTICLE_DEPOSIT_REACH {8}; // in cells around the landing cell
 constexpr u16    EMPTY_ELEMENT {0};
 constexpr u16    ANY_ELEMENT {std::numeric_limits<u16>::max()};
\ No newline at end of file
@@ -0,0 +1,131 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "ElementScript.hpp"
+
+auto world_def::find_element(std::string const& name) const -> i32
+{
+    for (auto const& element : Elements) {
+        if (element.Name == name) { return element.Element.ID; }
+    }
+    return -1;
+}
+
+////////////////////////////////////////////////////////////
+
+using script_element_vec = std::vector<std::tuple<u16, std::string, table>>;
+
+auto load_elements(path const& file) -> std::optional<world_def>
+{
+    world_def world;
+
+    script                                            luaScript;
+    std::vector<scripting::native_closure_shared_ptr> funcs;
+    script_element_vec                                elements;
+
+    luaScript.open_libraries(library::Table, library::String, library::Math, library::Coroutine);
+    auto& global {luaScript.global_table()};
+    table env {luaScript.create_table()};
+    env["table"]     = global["table"];
+    env["string"]    = global["string"];
+    env["math"]      = global["math"];
+    env["coroutine"] = global["coroutine"];
+
+    env["pairs"]        = global["pairs"];
+    env["ipairs"]       = global["ipairs"];
+    env["print"]        = global["print"];
+    env["type"]         = global["type"];
+    env["tonumber"]     = global["tonumber"];
+    env["tostring"]     = global["tostring"];
+    env["setmetatable"] = global["setmetatable"];
+    env["getmetatable"] = global["getmetatable"];
+
+    auto const make_func {[&](auto&& func) {
+        return funcs.emplace_back(make_shared_closure(std::function {func})).get();
+    }};
+
+    env["element"]        = make_func([&](std::string const& name, table const& table) {
+        elements.emplace_back(static_cast<u16>(elements.size()), name, table);
+    });
+    env["world"]          = make_func([&](table const& table) {
+        table.try_get(world.GridSize.Width, "Width");
+        table.try_get(world.GridSize.Height, "Height");
+        table.try_get(world.Seed, "Seed");
+    });
+    luaScript.Environment = env;
+
+    // a script that fails part-way has only defined some of the elements
+    if (!luaScript.run_file(file)) { return std::nullopt; }
+
+    auto const name_to_id {[&](std::string const& f) -> u16 {
+        if (f == "Any") { return ANY_ELEMENT; }
+
+        for (auto const& [id, name, table] : elements) {
+            if (name == f) { return id; }
+        }
+        return EMPTY_ELEMENT;
+    }};
+
+    for (auto const& [id, name, elementTable] : elements) {
+        element_def& element {world.Elements.emplace_back()};
+        element.Element.ID = id;
+        element.Name       = name;
+
+        // required
+        element.Element.Gravity = elementTable["Gravity"].as<i8>();
+        element.Element.Density = elementTable["Density"].as<f32>();
+        element.Element.Type    = elementTable["Type"].as<element_type>();
+
+        // optional
+        std::vector<std::string> colors;
+        elementTable.try_get(colors, "Colors");
+        for (auto const& color : colors) {
+            element.Colors.push_back(color::FromString(color));
+        }
+
+        elementTable.try_get(element.Temperature, "Temperature");
+        elementTable.try_get(element.Element.ThermalConductivity, "ThermalConductivity");
+        elementTable.try_get(element.Element.Dispersion, "Dispersion");
+        elementTable.try_get(element.Element.Dissolvable, "Dissolvable");
+
+        table rulesTable;
+        if (elementTable.try_get(rulesTable, "Rules")) {
+            auto const keys {rulesTable.get_keys<i32>()};
+            for (auto const& key : keys) {
+                table ruleTable {rulesTable[key].as<table>()};
+
+                if (ruleTable.has("Temperature")) {
+                    temp_rule val;
+                    table     tab {ruleTable["Temperature"].as<table>()};
+
+                    if (tab.try_get(val.Temperature, "Above")) {
+                        val.Op = comp_op::GreaterThan;
+                    } else if (tab.try_get(val.Temperature, "Below")) {
+                        val.Op = comp_op::LessThan;
+                    }
+                    val.Result = name_to_id(tab["Result"].as<std::string>());
+                    element.Rules.emplace_back(val);
+                } else if (ruleTable.has("Neighbor")) {
+                    neighbor_rule val;
+                    table         tab {ruleTable["Neighbor"].as<table>()};
+
+                    val.Element        = name_to_id(tab["Element"].as<std::string>());
+                    val.NeighborResult = name_to_id(tab["NeighborResult"].as<std::string>());
+                    val.Result         = name_to_id(tab["Result"].as<std::string>());
+                    element.Rules.emplace_back(val);
+                } else if (ruleTable.has("Dissolve")) {
+                    dissolve_rule val;
+                    table         tab {ruleTable["Dissolve"].as<table>()};
+
+                    val.Element = name_to_id(tab["Element"].as<std::string>());
+                    val.Result  = name_to_id(tab["Result"].as<std::string>());
+                    element.Rules.emplace_back(val);
+                }
+            }
+        }
+    }
+
+    return world;
+}
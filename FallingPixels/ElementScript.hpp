@@ -0,0 +1,24 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "Common.hpp" // IWYU pragma: keep
+
+#include "ElementSystem.hpp"
+
+////////////////////////////////////////////////////////////
+
+struct world_def final {
+    size_i                   GridSize {DEFAULT_GRID_SIZE};
+    u64                      Seed {DEFAULT_WORLD_SEED};
+    std::vector<element_def> Elements;
+
+    auto find_element(std::string const& name) const -> i32;
+};
+
+// runs an elements script (world{} and element{} calls) and converts it into element definitions;
+// empty if the script couldn't be run to the end
+auto load_elements(path const& file) -> std::optional<world_def>;
@@ -5,6 +5,11 @@
 
 #include "ElementSystem.hpp"
 
+// SSE2 is part of every x86-64 target, so the stencil needs no extra compiler flags
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
+
 template <typename T>
 auto comp(comp_op op, T a, T b) -> bool
 {
@@ -22,16 +27,216 @@ auto comp(comp_op op, T a, T b) -> bool
 static constexpr std::array<point_i, 8> NEIGHBORS {
     {{-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {1, 1}, {1, -1}, {-1, 1}}};
 
-element_system::element_system(std::vector<element_def> const& elements)
-    : _grid {}
+// incandescence: cells above GLOW_START blend towards GLOW_COLOR
+static constexpr f32         GLOW_START {525.0f};
+static constexpr f32         GLOW_FULL {1500.0f};
+static constexpr tcob::color GLOW_COLOR {255, 190, 120, 255};
+
+static auto glow_level(f32 temp) -> u8
+{
+    if (temp <= GLOW_START) { return 0; }
+    return static_cast<u8>(std::min((temp - GLOW_START) / (GLOW_FULL - GLOW_START), 1.0f) * 160.0f);
+}
+
+static auto apply_glow(tcob::color col, u8 level) -> tcob::color
+{
+    auto const blend {[level](u8 a, u8 b) { return static_cast<u8>(((a * (255 - level)) + (b * level)) / 255); }};
+    return {blend(col.R, GLOW_COLOR.R), blend(col.G, GLOW_COLOR.G), blend(col.B, GLOW_COLOR.B), col.A};
+}
+
+static auto mix(u64 z) -> u64
+{
+    // splitmix64 finalizer
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+element_rng::element_rng(u64 seed, u64 tick, u64 stream)
+    : _key {mix(mix(seed) ^ mix(tick + 0x9e3779b97f4a7c15ull) ^ (stream * 0xd1b54a32d192ed03ull))}
+{
+}
+
+auto element_rng::operator()(i32 min, i32 max) -> i32
+{
+    u64 const val {mix(_key + (++_counter * 0x9e3779b97f4a7c15ull))};
+    return min + static_cast<i32>(val % static_cast<u64>(max - min + 1));
+}
+
+////////////////////////////////////////////////////////////
+
+auto merge_rects(rect_i const& a, rect_i const& b) -> rect_i
 {
+    if (a.Size.Width == 0) { return b; }
+    if (b.Size.Width == 0) { return a; }
+
+    point_i const topLeft {std::min(a.Position.X, b.Position.X), std::min(a.Position.Y, b.Position.Y)};
+    point_i const bottomRight {std::max(a.Position.X + a.Size.Width, b.Position.X + b.Size.Width),
+                               std::max(a.Position.Y + a.Size.Height, b.Position.Y + b.Size.Height)};
+    return {topLeft.X, topLeft.Y, bottomRight.X - topLeft.X, bottomRight.Y - topLeft.Y};
+}
+
+////////////////////////////////////////////////////////////
+
+static auto make_table(std::vector<element_def> const& elements) -> std::vector<element_def>
+{
+    usize count {1};
+    for (auto const& el : elements) {
+        count = std::max(count, static_cast<usize>(el.Element.ID) + 1);
+    }
+
+    std::vector<element_def> retValue(count);
     for (auto const& el : elements) {
-        _elements[el.Element.ID] = el;
+        retValue[el.Element.ID] = el;
+    }
+
+    // resolve rule results once, so lookups during the update never leave the table
+    auto const resolve {[&](u16 id) -> u16 { return id < count ? id : EMPTY_ELEMENT; }};
+    for (auto& el : retValue) {
+        if (el.Colors.empty()) { el.Colors.push_back(colors::Black); }
+
+        for (auto& rule : el.Rules) {
+            std::visit(
+                overloaded {
+                    [&](temp_rule& r) { r.Result = resolve(r.Result); },
+                    [&](neighbor_rule& r) {
+                        r.NeighborResult = resolve(r.NeighborResult);
+                        r.Result         = resolve(r.Result);
+                    },
+                    [&](dissolve_rule& r) { r.Result = resolve(r.Result); }},
+                rule);
+        }
     }
+
+    return retValue;
+}
+
+static auto make_palettes(std::vector<element_def> const& elements) -> std::vector<tcob::color>
+{
+    std::vector<tcob::color> retValue(elements.size() * 256);
+    for (usize id {0}; id < elements.size(); ++id) {
+        auto const& colors {elements[id].Colors};
+        for (usize v {0}; v < 256; ++v) {
+            retValue[(id * 256) + v] = colors[v % colors.size()];
+        }
+    }
+    return retValue;
+}
+
+static auto make_properties(std::vector<element_def> const& elements) -> std::vector<element>
+{
+    std::vector<element> retValue;
+    retValue.reserve(elements.size());
+    for (auto const& el : elements) {
+        retValue.push_back(el.Element);
+    }
+    return retValue;
+}
+
+static auto make_reactions(std::vector<element_def> const& elements) -> std::vector<element_reactions>
+{
+    std::vector<element_reactions> retValue(elements.size());
+
+    for (usize idx {0}; idx < elements.size(); ++idx) {
+        auto const&        el {elements[idx]};
+        element_reactions& reactions {retValue[idx]};
+
+        // for each neighbor ID only the first matching rule can ever fire
+        auto const add_neighbor {[&](u16 target, element_reactions::neighbor const& val) {
+            if (reactions.Neighbors.empty()) { reactions.Neighbors.resize(elements.size()); }
+            for (usize id {0}; id < elements.size(); ++id) {
+                bool const matches {target == ANY_ELEMENT ? id != EMPTY_ELEMENT : id == target};
+                if (!matches || (val.Dissolve && !elements[id].Element.Dissolvable)) { continue; }
+                if (val.Priority < reactions.Neighbors[id].Priority) { reactions.Neighbors[id] = val; }
+            }
+        }};
+
+        for (usize ruleIdx {0}; ruleIdx < el.Rules.size(); ++ruleIdx) {
+            u8 const priority {static_cast<u8>(std::min<usize>(ruleIdx, element_reactions::NoReaction - 1))};
+            std::visit(
+                overloaded {
+                    [&](temp_rule const& r) {
+                        reactions.Thresholds.push_back({.Temperature = r.Temperature, .Op = r.Op, .Priority = priority, .Result = r.Result});
+                    },
+                    [&](neighbor_rule const& r) {
+                        add_neighbor(r.Element, {.Priority = priority, .Dissolve = false, .NeighborResult = r.NeighborResult, .Result = r.Result});
+                    },
+                    [&](dissolve_rule const& r) {
+                        add_neighbor(r.Element, {.Priority = priority, .Dissolve = true, .NeighborResult = EMPTY_ELEMENT, .Result = r.Result});
+                    }},
+                el.Rules[ruleIdx]);
+        }
+
+        if (!reactions.Thresholds.empty()) {
+            reactions.StableMin = std::numeric_limits<f32>::lowest();
+            reactions.StableMax = std::numeric_limits<f32>::max();
+            for (auto const& t : reactions.Thresholds) {
+                switch (t.Op) {
+                case comp_op::GreaterThan: reactions.StableMax = std::min(reactions.StableMax, t.Temperature); break;
+                case comp_op::LessThan:    reactions.StableMin = std::max(reactions.StableMin, t.Temperature); break;
+                default:                   // no stable band
+                    reactions.StableMin = std::numeric_limits<f32>::max();
+                    reactions.StableMax = std::numeric_limits<f32>::lowest();
+                    break;
+                }
+            }
+        }
+    }
+
+    return retValue;
+}
+
+static auto make_heat_sensitive(std::vector<element_reactions> const& reactions) -> std::vector<u8>
+{
+    std::vector<u8> retValue;
+    retValue.reserve(reactions.size());
+    for (auto const& r : reactions) {
+        retValue.push_back(!r.Thresholds.empty());
+    }
+    return retValue;
+}
+
+static auto make_tile_size(size_i reach) -> size_i
+{
+    // scheduler tiles are whole chunks and at least twice the reach of a single cell
+    auto const tile_extent {[](i32 val) { return std::max(((2 * val) + CHUNK_SIZE - 1) / CHUNK_SIZE, 1) * CHUNK_SIZE; }};
+    return {tile_extent(reach.Width), tile_extent(reach.Height)};
+}
+
+element_system::element_system(std::vector<element_def> const& elements, size_i gridSize, u64 seed)
+    : _elements {make_table(elements)}
+    , _reactions {make_reactions(_elements)}
+    , _heatSensitive {make_heat_sensitive(_reactions)}
+    , _palettes {make_palettes(_elements)}
+    , _grid {make_properties(_elements), gridSize}
+    , _tileSize {make_tile_size(_grid.reach())}
+    , _seed {seed}
+{
+}
+
+auto element_system::size() const -> size_i
+{
+    return _grid.size();
+}
+
+auto element_system::seed() const -> u64
+{
+    return _seed;
+}
+
+auto element_system::tick() const -> u64
+{
+    return _tick;
+}
+
+auto element_system::element_count() const -> usize
+{
+    return _elements.size();
 }
 
 auto element_system::info_name(point_i i) const -> std::string
 {
+    if (!_grid.contains(i)) { return id_to_element(EMPTY_ELEMENT)->Name; }
     return id_to_element(_grid.id(i))->Name;
 }
 
@@ -40,41 +245,120 @@ auto element_system::info_heat(point_i i) const -> f32
     return _grid.temperature(i);
 }
 
+auto element_system::info_chunks() const -> std::pair<i32, i32>
+{
+    return {_grid.active_chunks(), _grid.chunk_count().area()};
+}
+
 void element_system::update()
 {
+    using clock = std::chrono::steady_clock;
+
+    auto       start {clock::now()};
+    auto const lap {[&start](milliseconds& dst) {
+        auto const now {clock::now()};
+        dst   = now - start;
+        start = now;
+    }};
+
     _grid.reset_moved();
+    lap(_lastUpdate.ResetMoved);
+    _grid.update_chunks();
+    lap(_lastUpdate.Chunks);
     update_temperature();
+    lap(_lastUpdate.Temperature);
     update_grid();
+    lap(_lastUpdate.Grid);
+    update_particles();
+    lap(_lastUpdate.Particles);
+    _grid.update_dirty_rects();
+    lap(_lastUpdate.DirtyRects);
+    _lastUpdate.Workers = std::exchange(_passWorkers, {});
+    ++_tick;
 }
 
-void element_system::draw_elements(gfx::texture& tex) const
+auto worker_stats::imbalance() const -> f64
 {
-    tex.update_data(point_i::Zero, _grid.size(), _grid.colors(), 0);
+    return Mean.count() > 0 ? Max / Mean : 0.0;
 }
 
-void element_system::draw_heatmap(gfx::texture& tex) const
+auto element_system::last_update() const -> update_stats const&
 {
-    auto const size {_grid.size()};
-    auto       img {gfx::image::CreateEmpty(size, gfx::image::format::RGBA)};
+    return _lastUpdate;
+}
 
-    static auto colors {gfx::color_gradient {{0, colors::Blue}, {0.5f, colors::White}, {1, colors::Red}}.colors()};
+void element_system::take_render_dirty(std::span<rect_i> dst)
+{
+    size_i const chunks {_grid.chunk_count()};
+    for (i32 y {0}; y < chunks.Height; ++y) {
+        for (i32 x {0}; x < chunks.Width; ++x) {
+            dst[x + (y * chunks.Width)] = _grid.take_render_dirty({x, y});
+        }
+    }
+}
 
-    for (i32 x {0}; x < size.Width; ++x) {
-        for (i32 y {0}; y < size.Height; ++y) {
-            point_i const pos {x, y};
-            f32           temp {_grid.temperature(pos)};
-            temp = 0.5f + (temp / (temp < 0 ? 400 : 1200)); // -200 to 600
-            temp = std::clamp(temp, 0.f, 1.f);
-            img.set_pixel(pos, colors[static_cast<u8>(temp * 255)]);
+void element_system::draw_elements(std::span<rect_i const> rects, std::span<tcob::color> dst) const
+{
+    // colors are made here from element ID, variation and temperature; rows of all rects are mapped in parallel
+    std::vector<i32> firstRow(rects.size() + 1, 0);
+    for (usize i {0}; i < rects.size(); ++i) { firstRow[i + 1] = firstRow[i] + rects[i].Size.Height; }
+
+    i32 const width {_grid.size().Width};
+    run_timed(parallel_pass::Draw, firstRow.back(), [&](par_task const& ctx) {
+        for (isize row {ctx.Start}; row < ctx.End; ++row) {
+            usize const   r {static_cast<usize>(std::ranges::upper_bound(firstRow, static_cast<i32>(row)) - firstRow.begin() - 1)};
+            rect_i const& rect {rects[r]};
+            i32 const     y {rect.Position.Y + static_cast<i32>(row) - firstRow[r]};
+
+            auto const temps {_grid.temperature_row(y)};
+            auto*      line {dst.data() + (static_cast<isize>(y) * width)};
+            for (i32 x {rect.Position.X}; x < rect.Position.X + rect.Size.Width; ++x) {
+                point_i const     pos {x, y};
+                u16 const         id {_grid.id(pos)};
+                tcob::color const col {_palettes[(static_cast<usize>(id) * 256) + _grid.variation(pos)]};
+                u8 const          glow {id == EMPTY_ELEMENT ? u8 {0} : glow_level(temps[x])}; // hot air stays dark
+                line[x] = glow == 0 ? col : apply_glow(col, glow);
+            }
         }
+    });
+}
+
+void element_system::draw_particles(std::span<tcob::color> dst) const
+{
+    size_i const size {_grid.size()};
+    for (usize idx {0}; idx < _particles.count(); ++idx) {
+        point_i const pos {static_cast<i32>(std::floor(_particles.PositionX[idx])), static_cast<i32>(std::floor(_particles.PositionY[idx]))};
+        if (!_grid.contains(pos)) { continue; }
+        dst[static_cast<usize>((pos.Y * size.Width) + pos.X)] = _palettes[(static_cast<usize>(_particles.ID[idx]) * 256) + _particles.Variation[idx]];
     }
+}
 
-    tex.update_data(img, 0);
+void element_system::draw_heatmap(std::span<tcob::color> dst) const
+{
+    static auto const colors {gfx::color_gradient {{0, colors::Blue}, {0.5f, colors::White}, {1, colors::Red}}.colors()};
+
+    size_i const size {_grid.size()};
+    run_timed(parallel_pass::Draw, size.Height, [&](par_task const& ctx) {
+        for (isize y {ctx.Start}; y < ctx.End; ++y) {
+            auto const temps {_grid.temperature_row(static_cast<i32>(y))};
+            auto*      row {dst.data() + (y * size.Width)};
+            for (i32 x {0}; x < size.Width; ++x) {
+                f32 temp {temps[x]};
+                temp   = 0.5f + (temp / (temp < 0 ? 400 : 1200)); // -200 to 600
+                temp   = std::clamp(temp, 0.f, 1.f);
+                row[x] = colors[static_cast<u8>(temp * 255)];
+            }
+        }
+    });
 }
 
 void element_system::spawn(point_i i, i32 t)
 {
-    auto const* element {id_to_element(t)};
+    auto const* element {id_to_element(static_cast<u16>(t))};
+    if (!element) { return; }
+
+    // spawn streams are placed after the tile streams
+    element_rng rng {_seed, _tick, (u64 {1} << 32) + _spawnCount++};
 
     switch (element->Element.Type) {
     case element_type::None:
@@ -84,59 +368,127 @@ void element_system::spawn(point_i i, i32 t)
                 point_i const pos {i.X - 5 + x, i.Y - 5 + y};
 
                 if (!_grid.contains(pos)) { continue; }
-                _grid.set(pos, *element, true);
+                _grid.set(pos, *element, true, rng);
             }
         }
         break;
     case element_type::Liquid:
         for (i32 x {0}; x < 50; ++x) {
-            point_i const pos {static_cast<i32>((i.X + rand(-5, 5))), static_cast<i32>((i.Y + rand(-5, 5)))};
+            point_i const pos {static_cast<i32>((i.X + rng(-5, 5))), static_cast<i32>((i.Y + rng(-5, 5)))};
 
             if (!_grid.contains(pos)) { continue; }
-            _grid.set(pos, *element, true);
+            _grid.set(pos, *element, true, rng);
         }
         break;
     case element_type::Powder:
         for (i32 x {0}; x < 10; ++x) {
-            point_i const pos {static_cast<i32>((i.X + rand(-5, 5))), static_cast<i32>((i.Y + rand(-5, 5)))};
+            point_i const pos {static_cast<i32>((i.X + rng(-5, 5))), static_cast<i32>((i.Y + rng(-5, 5)))};
 
             if (!_grid.contains(pos)) { continue; }
-            _grid.set(pos, *element, true);
+            _grid.set(pos, *element, true, rng);
         }
         break;
     case element_type::Gas:
         for (i32 x {0}; x < 100; ++x) {
-            point_i const pos {static_cast<i32>((i.X + rand(-5, 5))), static_cast<i32>((i.Y + rand(-5, 5)))};
+            point_i const pos {static_cast<i32>((i.X + rng(-5, 5))), static_cast<i32>((i.Y + rng(-5, 5)))};
 
             if (!_grid.contains(pos)) { continue; }
-            _grid.set(pos, *element, true);
+            _grid.set(pos, *element, true, rng);
         }
         break;
     }
 }
 
+void element_system::fill(rect_i const& rect, i32 t)
+{
+    auto const* element {id_to_element(static_cast<u16>(t))};
+    if (!element) { return; }
+
+    element_rng rng {_seed, _tick, (u64 {1} << 32) + _spawnCount++};
+    for (i32 y {rect.Position.Y}; y < rect.Position.Y + rect.Size.Height; ++y) {
+        for (i32 x {rect.Position.X}; x < rect.Position.X + rect.Size.Width; ++x) {
+            _grid.set({x, y}, *element, true, rng);
+        }
+    }
+}
+
+void element_system::explode(point_i center, i32 radius)
+{
+    element_rng rng {_seed, _tick, (u64 {1} << 32) + _spawnCount++};
+
+    // movable cells within the radius are thrown away from the center, and a bit upwards
+    for (i32 y {-radius}; y <= radius; ++y) {
+        for (i32 x {-radius}; x <= radius; ++x) {
+            point_i const pos {center.X + x, center.Y + y};
+            if ((x * x) + (y * y) > radius * radius || !_grid.contains(pos) || _grid.empty(pos)) { continue; }
+            if (auto const type {_grid.type(pos)}; type == element_type::Solid || type == element_type::None) { continue; }
+
+            f32 const     dist {std::max(std::sqrt(static_cast<f32>((x * x) + (y * y))), 1.0f)};
+            f32 const     strength {MAX_PARTICLE_SPEED * (1.0f - (dist / static_cast<f32>(radius + 1))) * static_cast<f32>(rng(50, 100)) / 100.0f};
+            point_f const vel {static_cast<f32>(x) / dist * strength, (static_cast<f32>(y) / dist * strength) - (strength * 0.5f)};
+            point_f const particlePos {static_cast<f32>(pos.X) + 0.5f, static_cast<f32>(pos.Y) + 0.5f};
+            if (!_particles.spawn(particlePos, vel, _grid.id(pos), _grid.variation(pos), _grid.temperature(pos))) { return; }
+
+            _grid.set(pos, _elements[EMPTY_ELEMENT], false, rng);
+        }
+    }
+}
+
 void element_system::clear()
 {
     _grid.clear();
+    _particles.clear();
 }
 
-void element_system::update_temperature()
+void element_system::restart(u64 seed)
 {
-    run_parallel([&](point_i pos) {
-        f32 const alpha {_grid.thermal_conductivity(pos)};
-        f32       avgTemp {0};
-        for (auto const& neighbor : NEIGHBORS) {
-            avgTemp += _grid.temperature(pos + neighbor);
+    clear();
+    _seed       = seed;
+    _tick       = 0;
+    _spawnCount = 0;
+}
+
+void element_system::reload(std::vector<element_def> const& elements)
+{
+    auto newElements {make_table(elements)};
+
+    // elements are matched by name; cells of removed elements become empty
+    std::vector<u16> remap(_elements.size() + 1, EMPTY_ELEMENT);
+    for (usize id {0}; id < _elements.size(); ++id) {
+        auto const it {std::ranges::find(newElements, _elements[id].Name, &element_def::Name)};
+        if (it != newElements.end()) { remap[id] = static_cast<u16>(it - newElements.begin()); }
+    }
+    remap.back() = static_cast<u16>(newElements.size()); // the wall
+
+    _elements      = std::move(newElements);
+    _reactions     = make_reactions(_elements);
+    _heatSensitive = make_heat_sensitive(_reactions);
+    _palettes      = make_palettes(_elements);
+    _grid.reload(make_properties(_elements), remap);
+    _tileSize = make_tile_size(_grid.reach());
+
+    for (usize idx {_particles.count()}; idx-- > 0;) {
+        u16 const id {_particles.ID[idx] < remap.size() ? remap[_particles.ID[idx]] : EMPTY_ELEMENT};
+        if (id == EMPTY_ELEMENT) {
+            _particles.retire(idx);
+        } else {
+            _particles.ID[idx] = id;
         }
-        avgTemp /= NEIGHBORS.size();
-        f32 const currentTemp {_grid.temperature(pos)};
-        _grid.temperature(pos, currentTemp + (alpha * (avgTemp - currentTemp)));
+    }
+}
+
+void element_system::update_temperature()
+{
+    run_timed(parallel_pass::Temperature, _grid.size().Height, [&](par_task const& ctx) {
+        _grid.diffuse_temperature(static_cast<i32>(ctx.Start), static_cast<i32>(ctx.End), _heatSensitive);
     });
+
+    _grid.swap_temperature();
 }
 
 void element_system::update_grid()
 {
-    run_parallel([&](point_i pos) {
+    run_parallel([&](point_i pos, element_rng& rng) {
         if (_grid.touched(pos)) { return; }
         if (auto elementID {_grid.id(pos)}; elementID != EMPTY_ELEMENT) {
 
@@ -144,58 +496,64 @@ void element_system::update_grid()
             if (!element) { return; }
 
             // rules
-            if (!element->Rules.empty()) { process_rules(pos, *element); }
+            if (auto const& reactions {_reactions[elementID]}; !reactions.empty()) { process_rules(pos, reactions, rng); }
 
             // gravity
-            if (element->Element.Gravity != 0) { process_gravity(pos, element->Element.Type); }
+            if (element->Element.Gravity != 0) { process_gravity(pos, element->Element.Type, rng); }
         }
     });
 }
 
-void element_system::process_rules(point_i i, element_def const& element)
-{
-    for (auto const& rule : element.Rules) {
-        if (_grid.touched(i)) { return; }
-
-        std::visit(
-            overloaded {
-                [&](temp_rule const& r) {
-                    f32 const temp(_grid.temperature(i));
-                    if (comp(r.Op, temp, r.Temperature)) {
-                        _grid.set(i, _elements[r.Result], false);
-                    }
-                },
-                [&](neighbor_rule const& r) {
-                    for (auto const& neighbor : NEIGHBORS) {
-                        point_i const np {i + neighbor};
-                        if (_grid.touched(np)) { continue; }
-
-                        i32 const eid {_grid.id(np)};
-                        if (eid == r.Element || (r.Element == ANY_ELEMENT && eid != EMPTY_ELEMENT)) { // ANY but empty
-                            _grid.set(np, _elements[r.NeighborResult], true);
-                            _grid.set(i, _elements[r.Result], true);
-                            return;
-                        }
-                    }
-                },
-                [&](dissolve_rule const& r) {
-                    for (auto const& neighbor : NEIGHBORS) {
-                        point_i const np {i + neighbor};
-                        if (_grid.touched(np) || !_grid.dissolvable(np)) { continue; }
-
-                        i32 const eid {_grid.id(np)};
-                        if (eid == r.Element || (r.Element == ANY_ELEMENT && eid != EMPTY_ELEMENT)) { // ANY but empty
-                            _grid.set(np, _elements[EMPTY_ELEMENT], false);
-                            _grid.set(i, _elements[r.Result], false);
-                            return;
-                        }
-                    }
-                }},
-            rule);
-    }
-}
-
-void element_system::process_gravity(point_i i, element_type elementType)
+void element_system::process_rules(point_i i, element_reactions const& reactions, element_rng& rng)
+{
+    u8 bestPriority {element_reactions::NoReaction};
+
+    // temperature
+    u16 tempResult {EMPTY_ELEMENT};
+    if (!reactions.Thresholds.empty()) {
+        f32 const temp {_grid.temperature(i)};
+        if (temp < reactions.StableMin || temp > reactions.StableMax) {
+            for (auto const& t : reactions.Thresholds) {
+                if (comp(t.Op, temp, t.Temperature)) {
+                    bestPriority = t.Priority;
+                    tempResult   = t.Result;
+                    break;
+                }
+            }
+        }
+    }
+
+    // neighbors: a single pass over the neighborhood, looking up each neighbor ID
+    element_reactions::neighbor const* bestNeighbor {nullptr};
+    point_i                            bestPos {};
+    if (!reactions.Neighbors.empty()) {
+        for (auto const& neighbor : NEIGHBORS) {
+            point_i const np {i + neighbor};
+            if (_grid.touched(np)) { continue; }
+
+            auto const& r {reactions.Neighbors[_grid.id(np)]};
+            if (r.Priority < bestPriority) {
+                bestPriority = r.Priority;
+                bestNeighbor = &r;
+                bestPos      = np;
+            }
+        }
+    }
+
+    if (bestPriority == element_reactions::NoReaction) { return; }
+
+    if (!bestNeighbor) {
+        _grid.set(i, _elements[tempResult], false, rng);
+    } else if (bestNeighbor->Dissolve) {
+        _grid.set(bestPos, _elements[EMPTY_ELEMENT], false, rng);
+        _grid.set(i, _elements[bestNeighbor->Result], false, rng);
+    } else {
+        _grid.set(bestPos, _elements[bestNeighbor->NeighborResult], true, rng);
+        _grid.set(i, _elements[bestNeighbor->Result], true, rng);
+    }
+}
+
+void element_system::process_gravity(point_i i, element_type elementType, element_rng& rng)
 {
     if (elementType != element_type::Liquid && elementType != element_type::Gas && elementType != element_type::Powder) {
         return;
@@ -226,6 +584,25 @@ void element_system::process_gravity(point_i i, element_type elementType)
         return false;
     }};
 
+    // fall along a ray of empty cells, one step further every tick up to MAX_FALL_SPEED
+    cell_motion motion {_grid.motion(i)};
+    i32 const   speed {std::min(motion.Speed + 1, MAX_FALL_SPEED)};
+    point_i     target {i};
+    for (i32 step {1}; step <= speed; ++step) {
+        point_i const next {i + point_i {0, gravity * step}};
+        if (!_grid.empty(next)) { break; }
+        target = next;
+    }
+    if (target != i) {
+        motion.Speed = static_cast<u8>(speed);
+        _grid.motion(i, motion);
+        if (_grid.swap(i, target)) { return; }
+    }
+
+    // landed: lose the speed
+    motion.Speed = 0;
+    _grid.motion(i, motion);
+
     // Try to move directly down if the cell below is less dense
     if (canPassThrough(down)) {
         if (_grid.swap(i, down)) { return; }
@@ -247,7 +624,7 @@ void element_system::process_gravity(point_i i, element_type elementType)
 
         // Try down-right or down-left if both are less dense
         if (downRightCheck && downLeftCheck) {
-            if (rand(0, 1) == 0) {
+            if (rng(0, 1) == 0) {
                 if (_grid.swap(i, dr)) { return; }
                 if (_grid.swap(i, dl)) { return; }
             } else {
@@ -268,30 +645,143 @@ void element_system::process_gravity(point_i i, element_type elementType)
     }
 
     if (elementType != element_type::Powder) {
-        // Try to move horizontally to the left or right if both are empty
-        if (_grid.empty(right) && _grid.empty(left)) {
-            if (rand(0, 1) == 0) {
-                if (_grid.swap(i, right)) { return; }
-                if (_grid.swap(i, left)) { return; }
-            } else {
-                if (_grid.swap(i, left)) { return; }
-                if (_grid.swap(i, right)) { return; }
+        // keep flowing sideways in one direction, up to the dispersion, until something is hit or the cell can fall again
+        bool const flowRight {_grid.empty(right)};
+        bool const flowLeft {_grid.empty(left)};
+        if (motion.Flow == 0 || (motion.Flow > 0 ? !flowRight : !flowLeft)) {
+            if (flowRight && flowLeft) {
+                motion.Flow = rng(0, 1) == 0 ? 1 : -1;
+            } else if (flowRight || flowLeft) {
+                motion.Flow = flowRight ? 1 : -1;
             }
         }
 
-        // If only right is empty, move there
-        if (_grid.empty(right)) {
-            if (_grid.swap(i, right)) { return; }
+        target = i;
+        for (i32 step {1}; step <= std::max<i32>(disp, 1); ++step) {
+            point_i const next {i + point_i {motion.Flow * step, 0}};
+            if (!_grid.empty(next)) { break; }
+            target = next;
+            if (canPassThrough(next + point_i {0, gravity})) { break; }
         }
 
-        // If only left is empty, move there
-        if (_grid.empty(left)) {
-            if (_grid.swap(i, left)) { return; }
-        }
+        _grid.motion(i, motion);
+        if (target != i) { _grid.swap(i, target); }
         return;
     }
 }
 
+void element_system::update_particles()
+{
+    if (_particles.count() == 0) { return; }
+
+    // the cells the particles leave have to be redrawn
+    for (usize idx {0}; idx < _particles.count(); ++idx) {
+        _grid.mark_render_dirty({static_cast<i32>(std::floor(_particles.PositionX[idx])), static_cast<i32>(std::floor(_particles.PositionY[idx]))});
+    }
+
+    // the grid is only read while integrating
+    run_timed(parallel_pass::Particles, static_cast<isize>(_particles.count()), [&](par_task const& ctx) {
+        for (isize idx {ctx.Start}; idx < ctx.End; ++idx) { integrate_particle(static_cast<usize>(idx)); }
+    });
+
+    // landed particles go back into the grid in index order, the rest are drawn at their new position
+    for (usize idx {0}; idx < _particles.count();) {
+        if (_particles.Landed[idx] && deposit_particle(idx)) {
+            _particles.retire(idx);
+            continue;
+        }
+        _grid.mark_render_dirty({static_cast<i32>(std::floor(_particles.PositionX[idx])), static_cast<i32>(std::floor(_particles.PositionY[idx]))});
+        ++idx;
+    }
+}
+
+void element_system::integrate_particle(usize idx)
+{
+    auto& p {_particles};
+
+    i8 const  gravity {_elements[p.ID[idx]].Element.Gravity};
+    f32 const accel {gravity > 0 ? PARTICLE_GRAVITY : gravity < 0 ? -PARTICLE_GRAVITY : 0.0f};
+    p.VelocityX[idx] = std::clamp(p.VelocityX[idx], -MAX_PARTICLE_SPEED, MAX_PARTICLE_SPEED);
+    p.VelocityY[idx] = std::clamp(p.VelocityY[idx] + accel, -MAX_PARTICLE_SPEED, MAX_PARTICLE_SPEED);
+
+    // walk the path cell by cell; the first occupied cell stops the particle in front of it
+    f32 const x0 {p.PositionX[idx]}, y0 {p.PositionY[idx]};
+    f32 const dx {p.VelocityX[idx]}, dy {p.VelocityY[idx]};
+    i32 const steps {std::max(static_cast<i32>(std::ceil(std::max(std::abs(dx), std::abs(dy)))), 1)};
+
+    point_i last {static_cast<i32>(std::floor(x0)), static_cast<i32>(std::floor(y0))};
+    for (i32 step {1}; step <= steps; ++step) {
+        f32 const     t {static_cast<f32>(step) / static_cast<f32>(steps)};
+        point_i const cell {static_cast<i32>(std::floor(x0 + (dx * t))), static_cast<i32>(std::floor(y0 + (dy * t)))};
+        if (cell == last) { continue; }
+        if (!_grid.contains(cell) || !_grid.empty(cell)) {
+            p.Landed[idx]  = 1;
+            p.Landing[idx] = last;
+            return;
+        }
+        last = cell;
+    }
+
+    p.PositionX[idx] = x0 + dx;
+    p.PositionY[idx] = y0 + dy;
+}
+
+auto element_system::deposit_particle(usize idx) -> bool
+{
+    auto& p {_particles};
+
+    // an earlier particle may have landed on the same cell; search rings of growing radius
+    // on the side against gravity, straight up first, then spreading sideways
+    i32 const     up {_elements[p.ID[idx]].Element.Gravity < 0 ? 1 : -1};
+    point_i const landing {p.Landing[idx]};
+    auto const    try_place {[&](i32 dx, i32 dy) {
+        point_i const pos {landing.X + dx, landing.Y + (dy * up)};
+        if (!_grid.contains(pos) || !_grid.empty(pos)) { return false; }
+        _grid.place(pos, p.ID[idx], p.Variation[idx], p.Temperature[idx]);
+        return true;
+    }};
+
+    for (i32 r {0}; r <= PARTICLE_DEPOSIT_REACH; ++r) {
+        for (i32 dy {0}; dy <= r; ++dy) {
+            if (dy == r) {
+                if (try_place(0, dy)) { return true; }
+                for (i32 dx {1}; dx <= r; ++dx) {
+                    if (try_place(-dx, dy) || try_place(dx, dy)) { return true; }
+                }
+            } else if (try_place(-r, dy) || try_place(r, dy)) {
+                return true;
+            }
+        }
+    }
+
+    // no room nearby: keep the particle and let it fall again from the landing cell
+    p.PositionX[idx] = static_cast<f32>(landing.X) + 0.5f;
+    p.PositionY[idx] = static_cast<f32>(landing.Y) + 0.5f;
+    p.VelocityX[idx] = 0;
+    p.VelocityY[idx] = 0;
+    p.Landed[idx]    = 0;
+    return false;
+}
+
+auto element_system::tile_count() const -> size_i
+{
+    size_i const size {_grid.size()};
+    return {(size.Width + _tileSize.Width - 1) / _tileSize.Width, (size.Height + _tileSize.Height - 1) / _tileSize.Height};
+}
+
+auto element_system::is_tile_awake(point_i tile) const -> bool
+{
+    size_i const  chunks {_grid.chunk_count()};
+    point_i const first {tile.X * _tileSize.Width / CHUNK_SIZE, tile.Y * _tileSize.Height / CHUNK_SIZE};
+    point_i const last {std::min(first.X + (_tileSize.Width / CHUNK_SIZE), chunks.Width), std::min(first.Y + (_tileSize.Height / CHUNK_SIZE), chunks.Height)};
+    for (i32 y {first.Y}; y < last.Y; ++y) {
+        for (i32 x {first.X}; x < last.X; ++x) {
+            if (_grid.is_awake({x, y})) { return true; }
+        }
+    }
+    return false;
+}
+
 auto element_system::higher_density(point_i i, f32 t) const -> bool
 {
     return _grid.density(i) > t;
@@ -302,13 +792,9 @@ auto element_system::lower_density(point_i i, f32 t) const -> bool
     return _grid.density(i) < t;
 }
 
-auto element_system::rand(i32 min, i32 max) -> i32
-{
-    return _rand(min, max);
-}
-
 void element_system::load(io::istream& stream)
 {
+    _particles.clear();
     _grid.load(stream);
 }
 
@@ -317,61 +803,380 @@ void element_system::save(io::ostream& stream) const
     _grid.save(stream);
 }
 
+auto element_system::hash() const -> u64
+{
+    return _grid.hash();
+}
+
 auto element_system::id_to_element(u16 t) const -> element_def const*
 {
-    auto it {_elements.find(t)};
-    if (it == _elements.end()) { return nullptr; }
-    return &it->second;
+    if (t >= _elements.size()) { return nullptr; }
+    return &_elements[t];
 }
 
 ////////////////////////////////////////////////////////////
 
-element_grid::element_grid()
+static void atomic_min(std::atomic<i32>& target, i32 val)
+{
+    i32 current {target.load(std::memory_order_relaxed)};
+    while (val < current && !target.compare_exchange_weak(current, val, std::memory_order_relaxed)) { }
+}
+
+static void atomic_max(std::atomic<i32>& target, i32 val)
+{
+    i32 current {target.load(std::memory_order_relaxed)};
+    while (val > current && !target.compare_exchange_weak(current, val, std::memory_order_relaxed)) { }
+}
+
+static auto make_grid_size(size_i size) -> size_i
+{
+    // round up to whole chunks
+    auto const round {[](i32 val, i32 max) { return std::clamp(((val + CHUNK_SIZE - 1) / CHUNK_SIZE) * CHUNK_SIZE, CHUNK_SIZE, max); }};
+    return {round(size.Width, MAX_GRID_SIZE.Width), round(size.Height, MAX_GRID_SIZE.Height)};
+}
+
+element_grid::element_grid(std::vector<element> elements, size_i size)
+    : _elements {std::move(elements)}
+    , _size {make_grid_size(size)}
+    , _chunks(static_cast<usize>(chunk_count().area()))
+    , _grid {_size, BORDER}
+    , _gridVariation {_size}
+    , _gridMotion {_size}
+    , _touched(static_cast<usize>((chunk_count().Width + 2) * (chunk_count().Height + 2) * CHUNK_SIZE), 0)
+    , _gridTemperature(static_cast<usize>((_size.Width + 2) * (_size.Height + 2)), 0.0f)
+    , _gridTemperatureBack(_gridTemperature.size(), 0.0f)
 {
+    init_elements();
     clear();
 }
 
+void element_grid::init_elements()
+{
+    // the wall: immovable and denser than anything
+    _wallID = static_cast<u16>(_elements.size());
+    _elements.push_back({.ID          = _wallID,
+                         .Type        = element_type::Solid,
+                         .Density     = std::numeric_limits<f32>::max(),
+                         .Dissolvable = false});
+
+    // a changed cell can affect every cell that looks at it during process_gravity or the rules;
+    // lookups must not reach past the border
+    _wakeMargin = {1, 1};
+    for (auto& el : _elements) {
+        el.Dispersion = std::min<u8>(el.Dispersion, BORDER);
+        el.Gravity    = static_cast<i8>(std::clamp<i32>(el.Gravity, -BORDER / MAX_FALL_SPEED, BORDER / MAX_FALL_SPEED));
+
+        _wakeMargin.Width  = std::max(_wakeMargin.Width, el.Dispersion + 1);
+        _wakeMargin.Height = std::max(_wakeMargin.Height, std::abs(static_cast<i32>(el.Gravity)) * MAX_FALL_SPEED);
+    }
+}
+
+void element_grid::reload(std::vector<element> elements, std::span<u16 const> remap)
+{
+    _elements = std::move(elements);
+    init_elements();
+
+    // temperatures, variations and motion stay; everything is re-evaluated and redrawn
+    for (i32 y {0}; y < _size.Height; ++y) {
+        for (i32 x {0}; x < _size.Width; ++x) {
+            u16& id {_grid[{x, y}]};
+            id = id < remap.size() ? remap[id] : EMPTY_ELEMENT;
+        }
+    }
+    _grid.fill_border(_wallID);
+    wake_all();
+}
+
 void element_grid::clear()
 {
-    _grid.fill({});
-    _gridTemperature.fill(20); // default ambient temp
-    _gridColors.fill(tcob::colors::Black);
-    _gridTouched.fill(false);
+    _grid.fill(EMPTY_ELEMENT);
+    _grid.fill_border(_wallID);
+    for (i32 y {0}; y < _size.Height; ++y) {
+        std::fill_n(_gridTemperature.begin() + static_cast<isize>(temperature_index({0, y})), _size.Width, 20.0f); // default ambient temp
+    }
+    _gridVariation.fill(0);
+    clear_touched();
+    _gridMotion.fill({});
+    wake_all();
+}
+
+////////////////////////////////////////////////////////////
+// snapshot format
+//   u32 magic, u16 version, i32 width, i32 height, u32 dataSize, u8 data[dataSize]
+// data
+//   u16 element count, u16 element IDs            -- palette
+//   element palette indices                        -- run-length coded
+//   color variations                               -- run-length coded
+//   temperature deltas, zigzag, 1/8 degree steps   -- run-length coded
+// run-length coding: varint token; even: (token >> 1) copies of the next varint, odd: (token >> 1) varint literals
+
+static constexpr u32 SNAPSHOT_MAGIC {0x53585046}; // "FPXS"
+static constexpr u16 SNAPSHOT_VERSION {2};
+static constexpr f32 SNAPSHOT_TEMP_SCALE {8.0f};
+
+static void write_varint(std::vector<u8>& dst, u32 val)
+{
+    while (val >= 0x80) {
+        dst.push_back(static_cast<u8>(val | 0x80));
+        val >>= 7;
+    }
+    dst.push_back(static_cast<u8>(val));
 }
 
+template <typename T>
+static void write_raw(std::vector<u8>& dst, T val)
+{
+    auto const bytes {std::bit_cast<std::array<u8, sizeof(T)>>(val)};
+    dst.insert(dst.end(), bytes.begin(), bytes.end());
+}
+
+static void rle_encode(std::vector<u8>& dst, std::span<u32 const> values)
+{
+    usize i {0};
+    while (i < values.size()) {
+        usize run {1};
+        while (i + run < values.size() && values[i + run] == values[i]) { ++run; }
+        if (run >= 3) {
+            write_varint(dst, static_cast<u32>(run << 1));
+            write_varint(dst, values[i]);
+            i += run;
+            continue;
+        }
+
+        // literals up to the next run of at least three values
+        usize end {i + 1};
+        while (end < values.size()
+               && !(end + 2 < values.size() && values[end] == values[end + 1] && values[end] == values[end + 2])) {
+            ++end;
+        }
+        write_varint(dst, static_cast<u32>(((end - i) << 1) | 1));
+        for (; i < end; ++i) { write_varint(dst, values[i]); }
+    }
+}
+
+class snapshot_reader final {
+public:
+    explicit snapshot_reader(std::span<u8 const> data)
+        : _data {data}
+    {
+    }
+
+    auto failed() const -> bool
+    {
+        return _failed;
+    }
+
+    auto varint() -> u32
+    {
+        u32 val {0};
+        for (i32 shift {0}; shift < 35; shift += 7) {
+            if (_pos >= _data.size()) { break; }
+            u8 const byte {_data[_pos++]};
+            val |= static_cast<u32>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) { return val; }
+        }
+        _failed = true;
+        return 0;
+    }
+
+    template <typename T>
+    auto raw() -> T
+    {
+        if (_pos + sizeof(T) > _data.size()) {
+            _failed = true;
+            return T {};
+        }
+        std::array<u8, sizeof(T)> bytes {};
+        std::copy_n(_data.begin() + static_cast<isize>(_pos), sizeof(T), bytes.begin());
+        _pos += sizeof(T);
+        return std::bit_cast<T>(bytes);
+    }
+
+    auto rle_decode(std::span<u32> dst) -> bool
+    {
+        usize i {0};
+        while (i < dst.size() && !_failed) {
+            u32 const   token {varint()};
+            usize const count {token >> 1};
+            if (count == 0 || count > dst.size() - i) { _failed = true; }
+            if (_failed) { break; }
+
+            if (token & 1) {
+                for (usize j {0}; j < count; ++j) { dst[i++] = varint(); }
+            } else {
+                std::fill_n(dst.begin() + static_cast<isize>(i), count, varint());
+                i += count;
+            }
+        }
+        return !_failed;
+    }
+
+private:
+    std::span<u8 const> _data;
+    usize               _pos {0};
+    bool                _failed {false};
+};
+
 void element_grid::load(io::istream& stream)
 {
-    auto const size {_grid.count()};
-    for (usize i {0}; i < size; ++i) {
-        _grid[i]            = stream.read<element>();
-        _gridTemperature[i] = stream.read<f32>();
-        _gridColors[i]      = stream.read<tcob::color>();
+    if (stream.read<u32>() != SNAPSHOT_MAGIC) { return; }
+    if (stream.read<u16>() != SNAPSHOT_VERSION) { return; }
+
+    size_i const fileSize {stream.read<i32>(), stream.read<i32>()};
+    u32 const    dataSize {stream.read<u32>()};
+    if (stream.is_eof()) { return; }
+    if (fileSize.Width <= 0 || fileSize.Height <= 0
+        || fileSize.Width > MAX_GRID_SIZE.Width || fileSize.Height > MAX_GRID_SIZE.Height) {
+        return;
+    }
+
+    // the palette, then three streams of at most a 5 byte token and a 5 byte varint per cell
+    if (dataSize > 2 + (2 * 65536) + (3 * 10 * static_cast<u64>(fileSize.area()))) { return; }
+
+    std::vector<u8> data(dataSize);
+    if (stream.read_n(std::span<u8> {data}) != std::ssize(data)) { return; }
+
+    // decode everything before touching the grid, so a broken file leaves it as it is
+    usize const      count {static_cast<usize>(fileSize.area())};
+    snapshot_reader  reader {data};
+    std::vector<u32> ids(count);
+    std::vector<u32> variations(count);
+    std::vector<u32> temps(count);
+
+    std::vector<u16> idPalette(reader.raw<u16>());
+    for (auto& id : idPalette) { id = reader.raw<u16>(); }
+    if (!reader.rle_decode(ids)) { return; }
+
+    if (!reader.rle_decode(variations)) { return; }
+    if (!reader.rle_decode(temps)) { return; }
+
+    if (std::ranges::any_of(ids, [&](u32 idx) { return idx >= idPalette.size(); })
+        || std::ranges::any_of(variations, [](u32 v) { return v > 255; })) {
+        return;
     }
-    _gridTouched.fill(false);
+
+    // cells outside of the current grid are dropped, missing cells stay untouched
+    i32 quantTemp {0};
+    for (i32 y {0}; y < fileSize.Height; ++y) {
+        for (i32 x {0}; x < fileSize.Width; ++x) {
+            usize const idx {static_cast<usize>((y * fileSize.Width) + x)};
+            u32 const   zigzag {temps[idx]};
+            quantTemp += static_cast<i32>(zigzag >> 1) ^ -static_cast<i32>(zigzag & 1);
+
+            point_i const pos {x, y};
+            if (!contains(pos)) { continue; }
+            u16 const id {idPalette[ids[idx]]};
+            _grid[pos]                               = id < _wallID ? id : EMPTY_ELEMENT;
+            _gridTemperature[temperature_index(pos)] = static_cast<f32>(quantTemp) / SNAPSHOT_TEMP_SCALE;
+            _gridVariation[pos]                      = static_cast<u8>(variations[idx]);
+        }
+    }
+    clear_touched();
+    _gridMotion.fill({});
+    wake_all();
 }
 
 void element_grid::save(io::ostream& stream) const
 {
-    auto const size {_grid.count()};
-    for (usize i {0}; i < size; ++i) {
-        stream.write(_grid[i]);
-        stream.write(_gridTemperature[i]);
-        stream.write(_gridColors[i]);
+    usize const      count {static_cast<usize>(_size.area())};
+    std::vector<u32> values(count);
+    std::vector<u8>  data;
+    data.reserve(count / 4);
+
+    // element IDs
+    std::vector<u16> idPalette;
+    std::vector<u32> idToIndex(std::numeric_limits<u16>::max() + 1, std::numeric_limits<u32>::max());
+    for (i32 y {0}, idx {0}; y < _size.Height; ++y) {
+        for (i32 x {0}; x < _size.Width; ++x, ++idx) {
+            u16 const id {_grid[{x, y}]};
+            if (idToIndex[id] == std::numeric_limits<u32>::max()) {
+                idToIndex[id] = static_cast<u32>(idPalette.size());
+                idPalette.push_back(id);
+            }
+            values[idx] = idToIndex[id];
+        }
+    }
+    write_raw(data, static_cast<u16>(idPalette.size()));
+    for (u16 const id : idPalette) { write_raw(data, id); }
+    rle_encode(data, values);
+
+    // color variations
+    for (i32 y {0}, idx {0}; y < _size.Height; ++y) {
+        for (i32 x {0}; x < _size.Width; ++x, ++idx) {
+            values[idx] = _gridVariation[{x, y}];
+        }
+    }
+    rle_encode(data, values);
+
+    // temperature: neighboring cells are close, so store the zigzag coded delta to the previous cell
+    i32 prevTemp {0};
+    for (i32 y {0}, idx {0}; y < _size.Height; ++y) {
+        f32 const* temps {_gridTemperature.data() + temperature_index({0, y})};
+        for (i32 x {0}; x < _size.Width; ++x, ++idx) {
+            i32 const quantTemp {static_cast<i32>(std::lround(temps[x] * SNAPSHOT_TEMP_SCALE))};
+            i32 const delta {quantTemp - prevTemp};
+            values[idx] = (static_cast<u32>(delta) << 1) ^ static_cast<u32>(delta >> 31);
+            prevTemp    = quantTemp;
+        }
+    }
+    rle_encode(data, values);
+
+    stream.write(SNAPSHOT_MAGIC);
+    stream.write(SNAPSHOT_VERSION);
+    stream.write(_size.Width);
+    stream.write(_size.Height);
+    stream.write(static_cast<u32>(data.size()));
+    stream.write(std::span<u8 const> {data});
+}
+
+auto element_grid::hash() const -> u64
+{
+    // FNV-1a over IDs, temperatures and variations in row-major order
+    u64        result {0xcbf29ce484222325};
+    auto const add {[&result](u32 val) {
+        for (i32 i {0}; i < 4; ++i) {
+            result ^= (val >> (i * 8)) & 0xFF;
+            result *= 0x100000001b3;
+        }
+    }};
+
+    for (i32 y {0}; y < _size.Height; ++y) {
+        f32 const* temps {_gridTemperature.data() + temperature_index({0, y})};
+        for (i32 x {0}; x < _size.Width; ++x) {
+            add(_grid[{x, y}]);
+            add(std::bit_cast<u32>(temps[x]));
+            add(_gridVariation[{x, y}]);
+        }
     }
+    return result;
 }
 
-void element_grid::set(point_i i, element_def const& element, bool useTemp)
+void element_grid::set(point_i i, element_def const& element, bool useTemp, element_rng& rng)
 {
     if (!contains(i)) { return; }
 
-    _grid[i]        = element.Element;
-    _gridTouched[i] = true;
+    _grid[i]       = element.Element.ID;
+    _gridMotion[i] = {};
+    set_touched(i, true);
+    mark_dirty(i);
 
     if (useTemp) {
-        _gridTemperature[i] = element.Temperature;
+        _gridTemperature[temperature_index(i)] = element.Temperature;
     }
 
-    _gridColors[i] = element.Colors[_rand(0, static_cast<i32>(element.Colors.size() - 1))];
+    _gridVariation[i] = static_cast<u8>(rng(0, 255));
+}
+
+void element_grid::place(point_i i, u16 id, u8 variation, f32 temp)
+{
+    if (!contains(i)) { return; }
+
+    _grid[i]                               = id;
+    _gridVariation[i]                      = variation;
+    _gridMotion[i]                         = {};
+    _gridTemperature[temperature_index(i)] = temp;
+    set_touched(i, true);
+    mark_dirty(i);
 }
 
 auto element_grid::swap(point_i i0, point_i i1) -> bool
@@ -382,14 +1187,18 @@ auto element_grid::swap(point_i i0, point_i i1) -> bool
     auto const id1 {id(i1)};
 
     if (id0 == id1) { return true; }
-    if (_gridTouched[i1] && id1 != EMPTY_ELEMENT) { return false; } // prevent teleportation
+    if (id1 != EMPTY_ELEMENT && touched(i1)) { return false; } // prevent teleportation
 
     std::swap(_grid[i0], _grid[i1]);
-    std::swap(_gridTemperature[i0], _gridTemperature[i1]);
-    std::swap(_gridColors[i0], _gridColors[i1]);
+    std::swap(_gridTemperature[temperature_index(i0)], _gridTemperature[temperature_index(i1)]);
+    std::swap(_gridVariation[i0], _gridVariation[i1]);
+    std::swap(_gridMotion[i0], _gridMotion[i1]);
+
+    set_touched(i0, id1 != EMPTY_ELEMENT);
+    set_touched(i1, id0 != EMPTY_ELEMENT);
 
-    _gridTouched[i0] = id1 != EMPTY_ELEMENT;
-    _gridTouched[i1] = id0 != EMPTY_ELEMENT;
+    mark_dirty(i0);
+    mark_dirty(i1);
 
     return true;
 }
@@ -397,77 +1206,317 @@ auto element_grid::swap(point_i i0, point_i i1) -> bool
 void element_grid::temperature(point_i i, f32 val)
 {
     if (!contains(i)) { return; }
-    _gridTemperature[i] = val;
+    _gridTemperature[temperature_index(i)] = val;
+}
+
+void element_grid::motion(point_i i, cell_motion val)
+{
+    _gridMotion[i] = val;
+}
+
+void element_grid::diffuse_temperature(i32 rowStart, i32 rowEnd, std::span<u8 const> heatSensitive)
+{
+    // Jacobi step of the 8-neighbor average: reads the front buffer, writes the back buffer
+    usize const stride {static_cast<usize>(_size.Width + 2)};
+    i32 const   width {_size.Width};
+
+    for (i32 y {rowStart}; y < rowEnd; ++y) {
+        auto const alpha {[&](i32 x) { return properties({x, y}).ThermalConductivity; }};
+
+        f32 const* up {_gridTemperature.data() + (static_cast<usize>(y) * stride)};
+        f32 const* mid {up + stride};
+        f32 const* down {mid + stride};
+        f32*       dst {_gridTemperatureBack.data() + (static_cast<usize>(y + 1) * stride) + 1};
+
+        i32 x {0};
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128 const eighth {_mm_set1_ps(0.125f)};
+        for (; x + 4 <= width; x += 4) {
+            __m128 sum {_mm_add_ps(_mm_loadu_ps(up + x), _mm_loadu_ps(up + x + 1))};
+            sum = _mm_add_ps(sum, _mm_loadu_ps(up + x + 2));
+            sum = _mm_add_ps(sum, _mm_loadu_ps(mid + x));
+            sum = _mm_add_ps(sum, _mm_loadu_ps(mid + x + 2));
+            sum = _mm_add_ps(sum, _mm_loadu_ps(down + x));
+            sum = _mm_add_ps(sum, _mm_loadu_ps(down + x + 1));
+            sum = _mm_add_ps(sum, _mm_loadu_ps(down + x + 2));
+
+            __m128 const current {_mm_loadu_ps(mid + x + 1)};
+            __m128 const delta {_mm_sub_ps(_mm_mul_ps(sum, eighth), current)};
+            __m128 const conductivity {_mm_setr_ps(alpha(x), alpha(x + 1), alpha(x + 2), alpha(x + 3))};
+            _mm_storeu_ps(dst + x, _mm_add_ps(current, _mm_mul_ps(conductivity, delta)));
+        }
+#endif
+        for (; x < width; ++x) {
+            f32 const sum {up[x] + up[x + 1] + up[x + 2] + mid[x] + mid[x + 2] + down[x] + down[x + 1] + down[x + 2]};
+            f32 const current {mid[x + 1]};
+            dst[x] = current + (alpha(x) * ((sum * 0.125f) - current));
+        }
+
+        // temperature rules have to be evaluated even if nothing moved nearby, glowing cells have to be redrawn
+        i32 redrawLeft {width}, redrawRight {-1};
+        for (x = 0; x < width; ++x) {
+            if (dst[x] == mid[x + 1]) { continue; }
+            if (heatSensitive[_grid[{x, y}]]) { wake({x, y}); }
+            if (_grid[{x, y}] != EMPTY_ELEMENT && glow_level(dst[x]) != glow_level(mid[x + 1])) {
+                redrawLeft  = std::min(redrawLeft, x);
+                redrawRight = x;
+            }
+        }
+        if (redrawLeft <= redrawRight) { mark_redraw(y, redrawLeft, redrawRight); }
+    }
+}
+
+void element_grid::swap_temperature()
+{
+    std::swap(_gridTemperature, _gridTemperatureBack);
 }
 
 auto element_grid::id(point_i i) const -> u16
 {
-    if (!contains(i)) { return EMPTY_ELEMENT; }
-    return _grid[i].ID;
+    return _grid[i];
 }
 
 auto element_grid::type(point_i i) const -> element_type
 {
-    if (!contains(i)) { return element_type::None; }
-    return _grid[i].Type;
+    return properties(i).Type;
 }
 
 auto element_grid::gravity(point_i i) const -> i8
 {
-    if (!contains(i)) { return 0; }
-    return _grid[i].Gravity;
+    return properties(i).Gravity;
 }
 
 auto element_grid::thermal_conductivity(point_i i) const -> f32
 {
-    if (!contains(i)) { return 0; }
-    return _grid[i].ThermalConductivity;
+    return properties(i).ThermalConductivity;
 }
 
 auto element_grid::density(point_i i) const -> f32
 {
-    if (!contains(i)) { return 0; }
-    return _grid[i].Density;
+    return properties(i).Density;
 }
 
 auto element_grid::dispersion(point_i i) const -> u8
 {
-    if (!contains(i)) { return 0; }
-    return _grid[i].Dispersion;
+    return properties(i).Dispersion;
 }
 
 auto element_grid::dissolvable(point_i i) const -> bool
 {
-    if (!contains(i)) { return false; }
-    return _grid[i].Dissolvable;
+    return properties(i).Dissolvable;
+}
+
+auto element_grid::properties(point_i i) const -> element const&
+{
+    return _elements[_grid[i]];
 }
 
 auto element_grid::touched(point_i i) const -> bool
 {
-    if (!contains(i)) { return true; }
-    return _gridTouched[i];
+    // workers on either side of a one-chunk gap tile share its words, see set_touched
+    u32& word {const_cast<u32&>(_touched[touched_index(i)])};
+    return (std::atomic_ref<u32> {word}.load(std::memory_order_relaxed) >> ((i.X + BORDER) % CHUNK_SIZE)) & 1;
+}
+
+auto element_grid::motion(point_i i) const -> cell_motion
+{
+    return _gridMotion[i];
+}
+
+auto element_grid::touched_index(point_i i) const -> usize
+{
+    static_assert(CHUNK_SIZE == 32, "one u32 per chunk row");
+    static_assert(BORDER == CHUNK_SIZE, "one chunk of border");
+
+    i32 const x {i.X + BORDER};
+    i32 const y {i.Y + BORDER};
+    i32 const chunk {((y / CHUNK_SIZE) * (chunk_count().Width + 2)) + (x / CHUNK_SIZE)};
+    return (static_cast<usize>(chunk) * CHUNK_SIZE) + static_cast<usize>(y % CHUNK_SIZE);
+}
+
+void element_grid::set_touched(point_i i, bool val)
+{
+    u32 const bit {u32 {1} << ((i.X + BORDER) % CHUNK_SIZE)};
+    // one word holds a row of 32 cells; with tiles one chunk wide two workers can write to the same gap tile
+    std::atomic_ref<u32> word {_touched[touched_index(i)]};
+    if (val) {
+        word.fetch_or(bit, std::memory_order_relaxed);
+    } else {
+        word.fetch_and(~bit, std::memory_order_relaxed);
+    }
+}
+
+void element_grid::clear_touched()
+{
+    std::ranges::fill(_touched, std::numeric_limits<u32>::max());
+    for (i32 y {0}; y < _size.Height; y += CHUNK_SIZE) {
+        for (i32 x {0}; x < _size.Width; x += CHUNK_SIZE) {
+            std::fill_n(_touched.begin() + static_cast<isize>(touched_index({x, y})), CHUNK_SIZE, 0);
+        }
+    }
 }
 
 auto element_grid::temperature(point_i i) const -> f32
 {
     if (!contains(i)) { return 0; }
-    return _gridTemperature[i];
+    return _gridTemperature[temperature_index(i)];
 }
 
-auto element_grid::color(point_i i) const -> tcob::color
+auto element_grid::temperature_index(point_i i) const -> usize
 {
-    if (!contains(i)) { return colors::Transparent; }
-    return _gridColors[i];
+    return (static_cast<usize>(i.Y + 1) * static_cast<usize>(_size.Width + 2)) + static_cast<usize>(i.X + 1);
 }
 
-auto element_grid::colors() const -> tcob::color const*
+auto element_grid::variation(point_i i) const -> u8
 {
-    return _gridColors.data();
+    if (!contains(i)) { return 0; }
+    return _gridVariation[i];
+}
+
+auto element_grid::temperature_row(i32 y) const -> std::span<f32 const>
+{
+    return {_gridTemperature.data() + temperature_index({0, y}), static_cast<usize>(_size.Width)};
 }
 
 void element_grid::reset_moved()
 {
-    _gridTouched.fill(false);
+    // cells are only touched by set and swap, which mark their chunk dirty;
+    // pending dirty rects cover cells set between ticks
+    size_i const chunks {chunk_count()};
+    for (i32 y {0}; y < chunks.Height; ++y) {
+        for (i32 x {0}; x < chunks.Width; ++x) {
+            auto const& c {get_chunk({x, y})};
+            if (c.Dirty.Size.Width == 0
+                && c.DirtyLeft.load(std::memory_order_relaxed) > c.DirtyRight.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            std::fill_n(_touched.begin() + static_cast<isize>(touched_index({x * CHUNK_SIZE, y * CHUNK_SIZE})), CHUNK_SIZE, 0);
+        }
+    }
+}
+
+void element_grid::wake(point_i i)
+{
+    if (!contains(i)) { return; }
+
+    auto& c {get_chunk({i.X / CHUNK_SIZE, i.Y / CHUNK_SIZE})};
+    if (!c.WakeNext.load(std::memory_order_relaxed)) { c.WakeNext.store(true, std::memory_order_relaxed); }
+}
+
+void element_grid::mark_render_dirty(point_i i)
+{
+    if (!contains(i)) { return; }
+
+    auto& c {get_chunk({i.X / CHUNK_SIZE, i.Y / CHUNK_SIZE})};
+    c.RenderDirty = merge_rects(c.RenderDirty, {i.X, i.Y, 1, 1});
+}
+
+void element_grid::mark_redraw(i32 y, i32 left, i32 right)
+{
+    // only the dirty rect, nothing needs to wake up
+    for (i32 chunkX {left / CHUNK_SIZE}; chunkX <= right / CHUNK_SIZE; ++chunkX) {
+        auto& c {get_chunk({chunkX, y / CHUNK_SIZE})};
+        atomic_min(c.DirtyLeft, std::max(left, chunkX * CHUNK_SIZE));
+        atomic_min(c.DirtyTop, y);
+        atomic_max(c.DirtyRight, std::min(right, ((chunkX + 1) * CHUNK_SIZE) - 1));
+        atomic_max(c.DirtyBottom, y);
+    }
+}
+
+void element_grid::mark_dirty(point_i i)
+{
+    auto& c {get_chunk({i.X / CHUNK_SIZE, i.Y / CHUNK_SIZE})};
+    atomic_min(c.DirtyLeft, i.X);
+    atomic_min(c.DirtyTop, i.Y);
+    atomic_max(c.DirtyRight, i.X);
+    atomic_max(c.DirtyBottom, i.Y);
+
+    // wake all chunks within reach of the changed cell
+    size_i const  chunks {chunk_count()};
+    point_i const first {std::max(i.X - _wakeMargin.Width, 0) / CHUNK_SIZE, std::max(i.Y - _wakeMargin.Height, 0) / CHUNK_SIZE};
+    point_i const last {std::min((i.X + _wakeMargin.Width) / CHUNK_SIZE, chunks.Width - 1), std::min((i.Y + _wakeMargin.Height) / CHUNK_SIZE, chunks.Height - 1)};
+    for (i32 y {first.Y}; y <= last.Y; ++y) {
+        for (i32 x {first.X}; x <= last.X; ++x) {
+            auto& n {get_chunk({x, y})};
+            if (!n.WakeNext.load(std::memory_order_relaxed)) { n.WakeNext.store(true, std::memory_order_relaxed); }
+        }
+    }
+}
+
+void element_grid::update_chunks()
+{
+    _activeChunks = 0;
+    for (auto& c : _chunks) {
+        c.Awake = c.WakeNext.exchange(false, std::memory_order_relaxed);
+        if (c.Awake) { ++_activeChunks; }
+    }
+}
+
+void element_grid::update_dirty_rects()
+{
+    for (auto& c : _chunks) {
+        i32 const left {c.DirtyLeft.exchange(std::numeric_limits<i32>::max(), std::memory_order_relaxed)};
+        i32 const top {c.DirtyTop.exchange(std::numeric_limits<i32>::max(), std::memory_order_relaxed)};
+        i32 const right {c.DirtyRight.exchange(std::numeric_limits<i32>::min(), std::memory_order_relaxed)};
+        i32 const bottom {c.DirtyBottom.exchange(std::numeric_limits<i32>::min(), std::memory_order_relaxed)};
+        c.Dirty       = left <= right ? rect_i {left, top, right - left + 1, bottom - top + 1} : rect_i::Zero;
+        c.RenderDirty = merge_rects(c.RenderDirty, c.Dirty);
+    }
+}
+
+void element_grid::wake_all()
+{
+    size_i const chunks {chunk_count()};
+    for (i32 y {0}; y < chunks.Height; ++y) {
+        for (i32 x {0}; x < chunks.Width; ++x) {
+            auto& c {get_chunk({x, y})};
+            c.WakeNext.store(true, std::memory_order_relaxed);
+            c.DirtyLeft.store(x * CHUNK_SIZE, std::memory_order_relaxed);
+            c.DirtyTop.store(y * CHUNK_SIZE, std::memory_order_relaxed);
+            c.DirtyRight.store(((x + 1) * CHUNK_SIZE) - 1, std::memory_order_relaxed);
+            c.DirtyBottom.store(((y + 1) * CHUNK_SIZE) - 1, std::memory_order_relaxed);
+        }
+    }
+}
+
+auto element_grid::is_awake(point_i chunk) const -> bool
+{
+    return get_chunk(chunk).Awake;
+}
+
+auto element_grid::dirty_rect(point_i chunk) const -> rect_i
+{
+    return get_chunk(chunk).Dirty;
+}
+
+auto element_grid::take_render_dirty(point_i chunk) -> rect_i
+{
+    return std::exchange(get_chunk(chunk).RenderDirty, rect_i::Zero);
+}
+
+auto element_grid::active_chunks() const -> i32
+{
+    return _activeChunks;
+}
+
+auto element_grid::reach() const -> size_i
+{
+    return _wakeMargin;
+}
+
+auto element_grid::chunk_count() const -> size_i
+{
+    return {_size.Width / CHUNK_SIZE, _size.Height / CHUNK_SIZE};
+}
+
+auto element_grid::get_chunk(point_i chunk) -> element_grid::chunk&
+{
+    return _chunks[static_cast<usize>(chunk.X + (chunk.Y * chunk_count().Width))];
+}
+
+auto element_grid::get_chunk(point_i chunk) const -> element_grid::chunk const&
+{
+    return _chunks[static_cast<usize>(chunk.X + (chunk.Y * chunk_count().Width))];
 }
 
 auto element_grid::contains(point_i p) const -> bool
@@ -477,7 +1526,7 @@ auto element_grid::contains(point_i p) const -> bool
 
 auto element_grid::size() const -> size_i
 {
-    return GRID_SIZE;
+    return _size;
 }
 
 auto element_grid::empty(point_i i) const -> bool
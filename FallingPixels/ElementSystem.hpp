@@ -7,6 +7,8 @@
 
 #include "Common.hpp" // IWYU pragma: keep
 
+#include "Particles.hpp"
+
 ////////////////////////////////////////////////////////////
 
 enum class element_type : u8 {
@@ -48,6 +50,33 @@ struct dissolve_rule {
 
 using rules = std::variant<temp_rule, neighbor_rule, dissolve_rule>;
 
+// the rules of one element flattened at load time; lower priority wins, like the rule order in the script
+struct element_reactions final {
+    static constexpr u8 NoReaction {std::numeric_limits<u8>::max()};
+
+    struct threshold {
+        f32     Temperature {};
+        comp_op Op {};
+        u8      Priority {NoReaction};
+        u16     Result {};
+    };
+
+    struct neighbor {
+        u8   Priority {NoReaction};
+        bool Dissolve {false};
+        u16  NeighborResult {};
+        u16  Result {};
+    };
+
+    std::vector<threshold> Thresholds; // in priority order
+    f32                    StableMin {std::numeric_limits<f32>::lowest()}; // no threshold fires within [StableMin, StableMax]
+    f32                    StableMax {std::numeric_limits<f32>::max()};
+
+    std::vector<neighbor> Neighbors; // indexed by neighbor element ID; empty without neighbor rules
+
+    auto empty() const -> bool { return Thresholds.empty() && Neighbors.empty(); }
+};
+
 ////////////////////////////////////////////////////////////
 
 struct element final {
@@ -73,19 +102,135 @@ struct element_def final {
 
 ////////////////////////////////////////////////////////////
 
+// bounding rectangle of both; empty rectangles are ignored
+auto merge_rects(rect_i const& a, rect_i const& b) -> rect_i;
+
+////////////////////////////////////////////////////////////
+
+// counter-based random stream: the same seed, tick and stream always give the same sequence,
+// no matter which worker thread draws from it
+class element_rng final {
+public:
+    element_rng(u64 seed, u64 tick, u64 stream);
+
+    auto operator()(i32 min, i32 max) -> i32;
+
+private:
+    u64 _key;
+    u64 _counter {0};
+};
+
+////////////////////////////////////////////////////////////
+
+// heap-allocated grid with CHUNK_SIZE x CHUNK_SIZE tiles stored contiguously
+template <typename T>
+class tiled_grid final {
+public:
+    tiled_grid() = default;
+    explicit tiled_grid(size_i size, i32 border = 0); // border in whole tiles of cells around the grid
+
+    auto operator[](point_i p) -> T&;
+    auto operator[](point_i p) const -> T const&;
+
+    void fill(T const& val);
+    void fill_border(T const& val);
+
+    auto size() const -> size_i;
+    auto index(point_i p) const -> usize;
+
+private:
+    size_i         _size {size_i::Zero};
+    i32            _border {0};
+    i32            _tilesPerRow {0};
+    std::vector<T> _data;
+};
+
+template <typename T>
+inline tiled_grid<T>::tiled_grid(size_i size, i32 border)
+    : _size {size}
+    , _border {border}
+    , _tilesPerRow {(size.Width + (2 * border)) / CHUNK_SIZE}
+    , _data(static_cast<usize>((size.Width + (2 * border)) * (size.Height + (2 * border))))
+{
+    assert(border % CHUNK_SIZE == 0);
+}
+
+template <typename T>
+inline auto tiled_grid<T>::operator[](point_i p) -> T&
+{
+    return _data[index(p)];
+}
+
+template <typename T>
+inline auto tiled_grid<T>::operator[](point_i p) const -> T const&
+{
+    return _data[index(p)];
+}
+
+template <typename T>
+inline void tiled_grid<T>::fill(T const& val)
+{
+    std::ranges::fill(_data, val);
+}
+
+template <typename T>
+inline void tiled_grid<T>::fill_border(T const& val)
+{
+    for (i32 y {-_border}; y < _size.Height + _border; ++y) {
+        bool const borderRow {y < 0 || y >= _size.Height};
+        for (i32 x {-_border}; x < _size.Width + _border; ++x) {
+            if (borderRow || x < 0 || x >= _size.Width) { (*this)[{x, y}] = val; }
+        }
+    }
+}
+
+template <typename T>
+inline auto tiled_grid<T>::size() const -> size_i
+{
+    return _size;
+}
+
+template <typename T>
+inline auto tiled_grid<T>::index(point_i p) const -> usize
+{
+    static_assert(std::has_single_bit(static_cast<u32>(CHUNK_SIZE)));
+
+    i32 const x {p.X + _border};
+    i32 const y {p.Y + _border};
+    i32 const tile {((y / CHUNK_SIZE) * _tilesPerRow) + (x / CHUNK_SIZE)};
+    i32 const local {((y % CHUNK_SIZE) * CHUNK_SIZE) + (x % CHUNK_SIZE)};
+    return (static_cast<usize>(tile) * CHUNK_SIZE * CHUNK_SIZE) + static_cast<usize>(local);
+}
+
+////////////////////////////////////////////////////////////
+
+// motion carried over between ticks
+struct cell_motion final {
+    u8 Speed {0}; // falling speed in steps of gravity
+    i8 Flow {0};  // sideways direction of liquids and gases
+};
+
 class element_grid final {
 public:
-    element_grid();
+    element_grid(std::vector<element> elements, size_i size);
 
     ////////////////////////////////////////////////////////////
 
-    void set(point_i i, element_def const& element, bool useTemp);
+    void set(point_i i, element_def const& element, bool useTemp, element_rng& rng);
+    void place(point_i i, u16 id, u8 variation, f32 temp);
 
     auto swap(point_i i0, point_i i1) -> bool;
 
     void temperature(point_i i, f32 val);
+    void motion(point_i i, cell_motion val);
+
+    void diffuse_temperature(i32 rowStart, i32 rowEnd, std::span<u8 const> heatSensitive);
+    void swap_temperature();
 
     ////////////////////////////////////////////////////////////
+    // unchecked: cells up to BORDER away from the grid are walls
+
+    static constexpr i32 BORDER {CHUNK_SIZE};
 
     auto id(point_i i) const -> u16;
 
@@ -103,110 +248,285 @@ public:
 
     auto touched(point_i i) const -> bool;
 
+    auto motion(point_i i) const -> cell_motion;
+
+    ////////////////////////////////////////////////////////////
+
     auto temperature(point_i i) const -> f32;
 
-    auto color(point_i i) const -> tcob::color;
-    auto colors() const -> tcob::color const*;
+    auto variation(point_i i) const -> u8;
+    auto temperature_row(i32 y) const -> std::span<f32 const>;
+
+    ////////////////////////////////////////////////////////////
+
+    void wake(point_i i);
+    void mark_render_dirty(point_i i);
+    void update_chunks();
+    void update_dirty_rects();
+
+    auto is_awake(point_i chunk) const -> bool;
+    auto dirty_rect(point_i chunk) const -> rect_i;
+    auto take_render_dirty(point_i chunk) -> rect_i;
+    auto active_chunks() const -> i32;
+    auto chunk_count() const -> size_i;
+    auto reach() const -> size_i;
 
     ////////////////////////////////////////////////////////////
 
     void reset_moved();
     void clear();
+    // replaces the element properties; remap is indexed by the old element ID, including the old wall
+    void reload(std::vector<element> elements, std::span<u16 const> remap);
 
     void load(io::istream& stream);
     void save(io::ostream& stream) const;
+    auto hash() const -> u64;
 
     auto contains(point_i p) const -> bool;
     auto size() const -> size_i;
     auto empty(point_i i) const -> bool;
 
 private:
+    struct chunk {
+        bool   Awake {true};
+        rect_i Dirty {};       // cells changed during the last tick
+        rect_i RenderDirty {}; // cells changed since the last take_render_dirty
+
+        std::atomic<bool> WakeNext {false};
+        std::atomic<i32>  DirtyLeft {std::numeric_limits<i32>::max()};
+        std::atomic<i32>  DirtyTop {std::numeric_limits<i32>::max()};
+        std::atomic<i32>  DirtyRight {std::numeric_limits<i32>::min()};
+        std::atomic<i32>  DirtyBottom {std::numeric_limits<i32>::min()};
+    };
+
+    auto properties(point_i i) const -> element const&;
+
+    void init_elements();
+
+    void mark_dirty(point_i i);
+    void mark_redraw(i32 y, i32 left, i32 right);
+    auto temperature_index(point_i i) const -> usize;
+    auto touched_index(point_i i) const -> usize;
+    void set_touched(point_i i, bool val);
+    void clear_touched();
+    auto get_chunk(point_i chunk) -> element_grid::chunk&;
+    auto get_chunk(point_i chunk) const -> element_grid::chunk const&;
+    void wake_all();
+
     template <typename T>
-    using grid = static_grid<T, GRID_SIZE.Width, GRID_SIZE.Height>;
+    using grid = tiled_grid<T>;
+
+    std::vector<element> _elements; // indexed by element ID, followed by the wall
+    u16                  _wallID {0};
+    size_i               _size;
+    size_i               _wakeMargin {1, 1};
 
-    grid<element>     _grid;
-    grid<f32>         _gridTemperature;
-    grid<tcob::color> _gridColors;
-    grid<bool>        _gridTouched;
+    std::vector<chunk> _chunks;
+    i32                _activeChunks {0};
 
-    rng _rand;
+    grid<u16>         _grid; // with a border of walls
+    grid<u8>          _gridVariation; // picks the color from the element's palette
+    grid<cell_motion> _gridMotion;
+
+    // one bit per cell, one word per chunk row; only chunks that changed are cleared each tick
+    // border chunks are always touched
+    std::vector<u32> _touched;
+
+    // row-major with a one cell border of 0 degrees; written by diffuse_temperature into the back buffer
+    std::vector<f32> _gridTemperature;
+    std::vector<f32> _gridTemperatureBack;
 };
 
 ////////////////////////////////////////////////////////////
 
+// passes that run on the task manager
+enum class parallel_pass : u8 {
+    Temperature,
+    Grid,
+    Particles,
+    Draw, // draw_elements and draw_heatmap since the previous update
+    Count
+};
+
+// busy time of the task manager workers during one pass; a pass made of several
+// run_parallel calls (the checkerboard phases of the grid) adds up each call's average and slowest worker
+struct worker_stats final {
+    i32          Workers {0};
+    milliseconds Mean {0};
+    milliseconds Max {0};
+
+    auto imbalance() const -> f64; // slowest worker / average worker, 0 if nothing ran
+};
+
+// wall-clock time of each phase of the last element_system::update
+struct update_stats final {
+    milliseconds ResetMoved {0};
+    milliseconds Chunks {0};
+    milliseconds Temperature {0};
+    milliseconds Grid {0};
+    milliseconds Particles {0};
+    milliseconds DirtyRects {0};
+
+    std::array<worker_stats, static_cast<usize>(parallel_pass::Count)> Workers;
+};
+
 class element_system final {
 public:
-    element_system(std::vector<element_def> const& elements);
+    element_system(std::vector<element_def> const& elements, size_i gridSize, u64 seed);
+
+    auto size() const -> size_i;
+    auto seed() const -> u64;
+    auto tick() const -> u64;
+    auto element_count() const -> usize;
 
     auto info_name(point_i i) const -> std::string;
     auto info_heat(point_i i) const -> f32;
+    auto info_chunks() const -> std::pair<i32, i32>;
 
     void update();
-    void draw_elements(gfx::texture& tex) const;
-    void draw_heatmap(gfx::texture& tex) const;
+    auto last_update() const -> update_stats const&;
+    void take_render_dirty(std::span<rect_i> dst);
+    void draw_elements(std::span<rect_i const> rects, std::span<tcob::color> dst) const;
+    void draw_heatmap(std::span<tcob::color> dst) const;
+    void draw_particles(std::span<tcob::color> dst) const;
 
     void spawn(point_i i, i32 t);
+    void fill(rect_i const& rect, i32 t);
+    void explode(point_i center, i32 radius);
     void clear();
-    auto rand(i32 min, i32 max) -> i32;
+    void restart(u64 seed); // clears the world and starts over as if it was just created with seed
+    void reload(std::vector<element_def> const& elements);
 
     void load(io::istream& stream);
     void save(io::ostream& stream) const;
+    auto hash() const -> u64;
 
 private:
     void update_temperature();
 
     void update_grid();
-    void process_rules(point_i i, element_def const& element);
-    void process_gravity(point_i i, element_type elementType);
+    void process_rules(point_i i, element_reactions const& reactions, element_rng& rng);
+    void process_gravity(point_i i, element_type elementType, element_rng& rng);
+
+    void update_particles();
+    void integrate_particle(usize idx);
+    auto deposit_particle(usize idx) -> bool;
 
     auto higher_density(point_i i, f32 t) const -> bool;
     auto lower_density(point_i i, f32 t) const -> bool;
     auto id_to_element(u16 t) const -> element_def const*;
 
     void run_parallel(auto&& func);
+    void run_timed(parallel_pass pass, isize count, auto&& func) const;
+    auto tile_count() const -> size_i;
+    auto is_tile_awake(point_i tile) const -> bool;
+
+    // only replaced by reload, between ticks
+    std::vector<element_def>       _elements;      // indexed by element ID
+    std::vector<element_reactions> _reactions;     // indexed by element ID
+    std::vector<u8>                _heatSensitive; // elements with temperature rules
+    std::vector<tcob::color>       _palettes;      // 256 colors per element ID, indexed by variation
 
-    element_grid _grid;
+    element_grid  _grid;
+    particle_pool _particles;
 
-    rng _rand;
+    size_i               _tileSize {CHUNK_SIZE, CHUNK_SIZE};
+    std::vector<point_i> _tiles;
 
-    std::unordered_map<u16, element_def> _elements;
+    u64 _seed {0};
+    u64 _tick {0};
+    u64 _spawnCount {0};
+
+    update_stats _lastUpdate;
+
+    // written by run_timed; the draw functions are const
+    static constexpr usize                                                     MaxProfiledWorkers {64};
+    mutable std::array<std::atomic<i64>, MaxProfiledWorkers>                   _workerBusy {}; // nanoseconds, by par_task::Thread
+    mutable std::array<worker_stats, static_cast<usize>(parallel_pass::Count)> _passWorkers;
 };
 
 inline void element_system::run_parallel(auto&& func)
 {
-    i32 const gridSize {GRID_SIZE.Width};
-    i32 const quarterGridSize {gridSize / 4};
-    i32 const eighthGridSize {gridSize / 8};
-
-    locate_service<task_manager>().run_parallel(
-        [&](par_task const& ctx) {
-            isize const idx {ctx.Thread};
-            i32 const   xStart {eighthGridSize * static_cast<i32>(idx)}, xEnd {eighthGridSize * static_cast<i32>(idx + 1)};
-            i32 const   yStart {idx % 2 == 0 ? 0 : quarterGridSize}, yEnd {idx % 2 == 0 ? quarterGridSize : gridSize};
-
-            for (i32 y {yEnd - 1}; y >= yStart; --y) {
-                if (y % 2 == 0) {
-                    for (i32 x {xStart}; x < xEnd; ++x) { func({x, y}); }
-                } else {
-                    for (i32 x {xEnd - 1}; x >= xStart; --x) { func({x, y}); }
+    size_i const gridSize {_grid.size()};
+    size_i const tileCount {tile_count()};
+
+    // rows alternate direction; sleeping chunks are skipped as a whole
+    auto const process_row {[&](i32 y, i32 xStart, i32 xEnd, element_rng& rng) {
+        i32 const chunkY {y / CHUNK_SIZE};
+        if (y % 2 == 0) {
+            for (i32 x {xStart}; x < xEnd;) {
+                i32 const segmentEnd {std::min(((x / CHUNK_SIZE) + 1) * CHUNK_SIZE, xEnd)};
+                if (_grid.is_awake({x / CHUNK_SIZE, chunkY})) {
+                    for (; x < segmentEnd; ++x) { func({x, y}, rng); }
                 }
+                x = segmentEnd;
             }
-        },
-        8);
+        } else {
+            for (i32 x {xEnd - 1}; x >= xStart;) {
+                i32 const segmentStart {std::max((x / CHUNK_SIZE) * CHUNK_SIZE, xStart)};
+                if (_grid.is_awake({x / CHUNK_SIZE, chunkY})) {
+                    for (; x >= segmentStart; --x) { func({x, y}, rng); }
+                }
+                x = segmentStart - 1;
+            }
+        }
+    }};
+
+    auto const process_tile {[&](point_i tile) {
+        i32 const xStart {tile.X * _tileSize.Width}, xEnd {std::min(xStart + _tileSize.Width, gridSize.Width)};
+        i32 const yStart {tile.Y * _tileSize.Height}, yEnd {std::min(yStart + _tileSize.Height, gridSize.Height)};
+
+        element_rng rng {_seed, _tick, static_cast<u64>(tile.X + (tile.Y * tileCount.Width))};
+        for (i32 y {yEnd - 1}; y >= yStart; --y) { process_row(y, xStart, xEnd, rng); }
+    }};
+
+    // checkerboard: tiles of one phase are at least one tile apart, and a tile is at least
+    // twice as large as the reach of a cell, so workers never touch the same cells
+    for (i32 phase {0}; phase < 4; ++phase) {
+        _tiles.clear();
+        for (i32 y {phase / 2}; y < tileCount.Height; y += 2) {
+            for (i32 x {phase % 2}; x < tileCount.Width; x += 2) {
+                if (is_tile_awake({x, y})) { _tiles.emplace_back(x, y); }
+            }
+        }
+        if (_tiles.empty()) { continue; }
+
+        // every task keeps pulling tiles until the phase is done, so busy tiles don't stall idle workers
+        std::atomic<usize> nextTile {0};
+        run_timed(parallel_pass::Grid, std::ssize(_tiles), [&](par_task const&) {
+            for (usize idx {nextTile.fetch_add(1, std::memory_order_relaxed)}; idx < _tiles.size();
+                 idx = nextTile.fetch_add(1, std::memory_order_relaxed)) {
+                process_tile(_tiles[idx]);
+            }
+        });
+    }
+}
 
+inline void element_system::run_timed(parallel_pass pass, isize count, auto&& func) const
+{
     locate_service<task_manager>().run_parallel(
         [&](par_task const& ctx) {
-            isize const idx {ctx.Thread};
-            i32 const   xStart {eighthGridSize * static_cast<i32>(idx)}, xEnd {eighthGridSize * static_cast<i32>(idx + 1)};
-            i32 const   yStart {idx % 2 != 0 ? 0 : quarterGridSize}, yEnd {idx % 2 != 0 ? quarterGridSize : gridSize};
-
-            for (i32 y {yEnd - 1}; y >= yStart; --y) {
-                if (y % 2 == 0) {
-                    for (i32 x {xStart}; x < xEnd; ++x) { func({x, y}); }
-                } else {
-                    for (i32 x {xEnd - 1}; x >= xStart; --x) { func({x, y}); }
-                }
-            }
+            auto const start {std::chrono::steady_clock::now()};
+            func(ctx);
+            auto const busy {std::chrono::steady_clock::now() - start};
+            _workerBusy[static_cast<usize>(ctx.Thread) % MaxProfiledWorkers].fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count(), std::memory_order_relaxed);
         },
-        8);
+        count);
+
+    i32 workers {0};
+    i64 total {0}, max {0};
+    for (auto& busy : _workerBusy) {
+        i64 const ns {busy.exchange(0, std::memory_order_relaxed)};
+        if (ns == 0) { continue; }
+        ++workers;
+        total += ns;
+        max = std::max(max, ns);
+    }
+    if (workers == 0) { return; }
+
+    worker_stats& stats {_passWorkers[static_cast<usize>(pass)]};
+    stats.Workers = std::max(stats.Workers, workers);
+    stats.Mean += std::chrono::nanoseconds {total / workers};
+    stats.Max += std::chrono::nanoseconds {max};
 }
@@ -11,28 +11,37 @@
 using namespace std::chrono_literals;
 using namespace tcob::literals;
 
-elements_entity::elements_entity(std::vector<element_def> const& elementsDefs)
-    : _elementSystem {std::make_unique<element_system>(elementsDefs)}
+static constexpr char const* ELEMENTS_SCRIPT {"elements.lua"};
+static constexpr char const* REPLAY_FILE {"replay.bin"};
+
+static auto last_write_time(path const& file) -> std::filesystem::file_time_type
+{
+    std::error_code ec;
+    auto const      retValue {std::filesystem::last_write_time(file, ec)};
+    return ec ? std::filesystem::file_time_type {} : retValue;
+}
+
+elements_entity::elements_entity(std::vector<element_def> const& elementsDefs, size_i gridSize, u64 seed)
+    : _simulation {std::make_unique<::simulation>(elementsDefs, gridSize, seed)}
     , _shape(&_layer0.create_shape<gfx::rect_shape>())
 {
-    _sandTex->resize(GRID_SIZE, 1, gfx::texture::format::RGBA8);
+    size_i const size {_simulation->size()};
+    _sandTex->resize(size, 1, gfx::texture::format::RGBA8);
     //_sandTex->Filtering = gfx::texture::filtering::Linear;
 
-    _shape->Bounds                         = {point_f::Zero, size_f {GRID_SIZE}};
+    _shape->Bounds                         = {point_f::Zero, size_f {size}};
     _shape->Material                       = _sandMat;
     _shape->Material->first_pass().Texture = _sandTex;
-
-    _hourGlass0.restart();
 }
 
 void elements_entity::on_update(milliseconds deltaTime)
 {
     _layer0.update(deltaTime);
 
-    if (_hourGlass0.elapsed_milliseconds() > 20) {
-        system().update();
-        update_image();
-        _hourGlass0.restart();
+    // the simulation ticks on its own thread; upload whatever it finished since the last frame
+    if (auto const* frame {_simulation->acquire_frame()}) {
+        update_image(*frame);
+        _simulation->release_frame(*frame);
     }
 }
 
@@ -42,7 +51,7 @@ void elements_entity::on_fixed_update(milliseconds)
 
 auto elements_entity::can_draw() const -> bool
 {
-    return _elementSystem != nullptr;
+    return _simulation != nullptr;
 }
 
 void elements_entity::on_draw_to(gfx::render_target& target, transform const& xform)
@@ -50,13 +59,27 @@ void elements_entity::on_draw_to(gfx::render_target& target, transform const& xf
     _layer0.draw_to(target, xform);
 }
 
-void elements_entity::update_image()
+void elements_entity::update_image(sim_frame const& frame)
 {
-    if (DrawHeatMap) {
-        system().draw_heatmap(*_sandTex.ptr());
-    } else {
-        system().draw_elements(*_sandTex.ptr());
+    auto const   timer {stopwatch::StartNew()};
+    size_i const size {_simulation->size()};
+    if (frame.FullUpload || frame.Heatmap != _textureIsHeatmap) {
+        _sandTex->update_data(point_i::Zero, size, frame.Pixels.data(), 0);
+        _textureIsHeatmap = frame.Heatmap;
+        _simulation->Profiler.add(profile_phase::Upload, timer.elapsed());
+        return;
+    }
+
+    // frame pixels are grid sized; pack each span before uploading it
+    for (auto const& rect : frame.Upload) {
+        _uploadBuffer.resize(static_cast<usize>(rect.Size.area()));
+        for (i32 y {0}; y < rect.Size.Height; ++y) {
+            auto const* src {frame.Pixels.data() + ((rect.Position.Y + y) * size.Width) + rect.Position.X};
+            std::copy_n(src, rect.Size.Width, _uploadBuffer.data() + (y * rect.Size.Width));
+        }
+        _sandTex->update_data(rect.Position, rect.Size, _uploadBuffer.data(), 0);
     }
+    _simulation->Profiler.add(profile_phase::Upload, timer.elapsed());
 }
 
 ////////////////////////////////////////////////////////////
@@ -64,87 +87,13 @@ void elements_entity::update_image()
 main_scene::main_scene(game& game)
     : scene {game}
 {
+    _worldWriteTime = last_write_time(ELEMENTS_SCRIPT);
+    _world          = load_elements(ELEMENTS_SCRIPT).value_or(world_def {});
+    _entity         = std::make_shared<elements_entity>(_world.Elements, _world.GridSize, _world.Seed);
 
     ////
-    script_element_vec const elements {load_script()};
-    auto const               name_to_id {[&](std::string const& f) -> u16 {
-        if (f == "Any") { return ANY_ELEMENT; }
-
-        for (auto const& [id, name, table] : elements) {
-            if (name == f) { return id; }
-        }
-        return EMPTY_ELEMENT;
-    }};
-
-    std::vector<element_def> elementsDefs;
-    for (auto const& [id, name, elementTable] : elements) {
-        element_def& element {elementsDefs.emplace_back()};
-        element.Element.ID = id;
-        element.Name       = name;
-
-        // required
-        element.Element.Gravity = elementTable["Gravity"].as<i8>();
-        element.Element.Density = elementTable["Density"].as<f32>();
-        element.Element.Type    = elementTable["Type"].as<element_type>();
-
-        // optional
-        std::vector<std::string> colors;
-        elementTable.try_get(colors, "Colors");
-        for (auto const& color : colors) {
-            element.Colors.push_back(color::FromString(color));
-        }
-
-        elementTable.try_get(element.Temperature, "Temperature");
-        elementTable.try_get(element.Element.ThermalConductivity, "ThermalConductivity");
-        elementTable.try_get(element.Element.Dispersion, "Dispersion");
-        elementTable.try_get(element.Element.Dissolvable, "Dissolvable");
-
-        table rulesTable;
-        if (elementTable.try_get(rulesTable, "Rules")) {
-            auto const keys {rulesTable.get_keys<i32>()};
-            for (auto const& key : keys) {
-                table ruleTable {rulesTable[key].as<table>()};
-
-                if (ruleTable.has("Temperature")) {
-                    temp_rule val;
-                    table     tab {ruleTable["Temperature"].as<table>()};
-
-                    if (tab.try_get(val.Temperature, "Above")) {
-                        val.Op = comp_op::GreaterThan;
-                    } else if (tab.try_get(val.Temperature, "Below")) {
-                        val.Op = comp_op::LessThan;
-                    }
-                    val.Result = name_to_id(tab["Result"].as<std::string>());
-                    element.Rules.emplace_back(val);
-                } else if (ruleTable.has("Neighbor")) {
-                    neighbor_rule val;
-                    table         tab {ruleTable["Neighbor"].as<table>()};
-
-                    val.Element        = name_to_id(tab["Element"].as<std::string>());
-                    val.NeighborResult = name_to_id(tab["NeighborResult"].as<std::string>());
-                    val.Result         = name_to_id(tab["Result"].as<std::string>());
-                    element.Rules.emplace_back(val);
-                } else if (ruleTable.has("Dissolve")) {
-                    dissolve_rule val;
-                    table         tab {ruleTable["Dissolve"].as<table>()};
-
-                    val.Element = name_to_id(tab["Element"].as<std::string>());
-                    val.Result  = name_to_id(tab["Result"].as<std::string>());
-                    element.Rules.emplace_back(val);
-                }
-            }
-        }
-    }
-
-    _entity = std::make_shared<elements_entity>(elementsDefs);
-
-    ////
-    auto&      win {window()};
-    auto const winSize {*win.Size};
-    _form = std::make_shared<elements_form>(rect_i {winSize.Height, 0, winSize.Width - winSize.Height, winSize.Height}, elementsDefs);
-    _form->SelectedElement.connect([&](i32 t) { _leftBtnElement = t; });
-
-    _entity->center_camera(win.camera());
+    create_form();
+    _entity->center_camera(window().camera());
 }
 
 main_scene::~main_scene() = default;
@@ -154,7 +103,8 @@ void main_scene::on_start()
     window().ClearColor = colors::SlateGray;
 
     root_node().create_child().Entity = _entity;
-    root_node().create_child().Entity = _form;
+    _formNode                         = &root_node().create_child();
+    _formNode->Entity                 = _form;
 }
 
 void main_scene::on_finish()
@@ -169,12 +119,17 @@ void main_scene::on_update(milliseconds deltaTime)
 {
     if (_mouseDown == input::mouse::button::Left) {
         auto const ev {point_i {window().camera().convert_screen_to_world(locate_service<input::system>().mouse().get_position())}};
-        _entity->system().spawn(ev, _spawnElement);
+        _entity->simulation().input({.Action = replay_action::Spawn, .Position = ev, .Value = _spawnElement});
     }
 }
 
 void main_scene::on_fixed_update(milliseconds deltaTime)
 {
+    if (auto const writeTime {last_write_time(ELEMENTS_SCRIPT)}; writeTime != _worldWriteTime) {
+        _worldWriteTime = writeTime;
+        reload_elements();
+    }
+
     std::stringstream stream;
     stream << std::fixed << std::setprecision(2);
     auto const& stats {locate_service<gfx::render_system>().statistics()};
@@ -183,8 +138,25 @@ void main_scene::on_fixed_update(milliseconds deltaTime)
     stream << " worst FPS:" << stats.worst_FPS();
 
     auto const ev {point_i {window().camera().convert_screen_to_world(locate_service<input::system>().mouse().get_position())}};
-    stream << "| name:" << _entity->system().info_name(ev);
-    stream << "| heat:" << _entity->system().info_heat(ev);
+    _entity->simulation().request_info(ev);
+    auto const info {_entity->simulation().info()};
+    stream << "| name:" << info.Name;
+    stream << "| heat:" << info.Heat;
+    stream << "| chunks:" << info.ActiveChunks << "/" << info.ChunkCount;
+    stream << "| TPS:" << info.TicksPerSecond;
+    if (i32 const tps {_entity->simulation().TicksPerSecond}; tps == MAX_SPEED) {
+        stream << " (max)";
+    } else {
+        stream << " (" << tps << ")";
+    }
+
+    if (!info.Replay.empty()) {
+        stream << "| " << info.Replay;
+    }
+
+    if (_showProfiler) {
+        stream << "| " << _entity->simulation().Profiler.summary();
+    }
 
     window().Title = "FallingPixels " + stream.str();
 }
@@ -194,15 +166,35 @@ void main_scene::on_key_down(input::keyboard::event const& ev)
     if (ev.ScanCode == input::scan_code::BACKSPACE) {
         parent().pop_current_scene();
     } else if (ev.ScanCode == input::scan_code::H) {
-        _entity->DrawHeatMap = !_entity->DrawHeatMap;
+        _entity->simulation().Heatmap = !_entity->simulation().Heatmap;
+    } else if (ev.ScanCode == input::scan_code::T) {
+        constexpr std::array<i32, 5> tickRates {25, 50, 100, 200, MAX_SPEED};
+        _tickRateStage                       = (_tickRateStage + 1) % static_cast<i32>(tickRates.size());
+        _entity->simulation().TicksPerSecond = tickRates[_tickRateStage];
+    } else if (ev.ScanCode == input::scan_code::P) {
+        _showProfiler = !_showProfiler;
     } else if (ev.ScanCode == input::scan_code::C) {
-        _entity->system().clear();
+        _entity->simulation().input({.Action = replay_action::Clear});
     } else if (ev.ScanCode == input::scan_code::S) {
-        io::ofstream stream {"grid.bin"};
-        _entity->system().save(stream);
+        _entity->simulation().post([](element_system& system) {
+            io::ofstream stream {"grid.bin"};
+            system.save(stream);
+        });
+    } else if (ev.ScanCode == input::scan_code::R) {
+        _recording = !_recording;
+        if (_recording) {
+            _entity->simulation().start_recording();
+        } else {
+            _entity->simulation().stop_recording(REPLAY_FILE);
+        }
+    } else if (ev.ScanCode == input::scan_code::E) {
+        // a missing or broken file is reported in the title and keeps a recording going
+        if (_entity->simulation().play(REPLAY_FILE)) { _recording = false; }
     } else if (ev.ScanCode == input::scan_code::L) {
-        io::ifstream stream {"grid.bin"};
-        _entity->system().load(stream);
+        _entity->simulation().post([](element_system& system) {
+            io::ifstream stream {"grid.bin"};
+            system.load(stream);
+        });
     }
 }
 
@@ -232,44 +224,37 @@ void main_scene::on_mouse_button_down(input::mouse::button_event const& ev)
 {
     if (ev.Button == input::mouse::button::Left) {
         _spawnElement = _leftBtnElement;
+    } else if (ev.Button == input::mouse::button::Middle) {
+        auto const pos {point_i {window().camera().convert_screen_to_world(locate_service<input::system>().mouse().get_position())}};
+        _entity->simulation().input({.Action = replay_action::Explode, .Position = pos, .Value = 12});
     }
     _mouseDown = ev.Button;
 }
 
-auto main_scene::load_script() -> script_element_vec
+void main_scene::create_form()
 {
-    using namespace scripting;
-
-    _script.open_libraries(library::Table, library::String, library::Math, library::Coroutine);
-    auto& global {_script.global_table()};
-    table env {_script.create_table()};
-    env["table"]     = global["table"];
-    env["string"]    = global["string"];
-    env["math"]      = global["math"];
-    env["coroutine"] = global["coroutine"];
-
-    env["pairs"]        = global["pairs"];
-    env["ipairs"]       = global["ipairs"];
-    env["print"]        = global["print"];
-    env["type"]         = global["type"];
-    env["tonumber"]     = global["tonumber"];
-    env["tostring"]     = global["tostring"];
-    env["setmetatable"] = global["setmetatable"];
-    env["getmetatable"] = global["getmetatable"];
-
-    auto const make_func {[&](auto&& func) {
-        return _funcs.emplace_back(make_shared_closure(std::function {func})).get();
-    }};
-
-    script_element_vec elements;
-    env["element"]      = make_func([&](std::string const& name, table const& table) {
-        elements.emplace_back(static_cast<u16>(elements.size()), name, table);
-    });
-    _script.Environment = env;
-
-    std::ignore = _script.run_file("elements.lua");
-
-    return elements;
+    auto const winSize {*window().Size};
+    _form = std::make_shared<elements_form>(rect_i {winSize.Height, 0, winSize.Width - winSize.Height, winSize.Height}, _world.Elements);
+    _form->SelectedElement.connect([&](i32 t) { _leftBtnElement = t; });
+}
+
+void main_scene::reload_elements()
+{
+    // grid size and seed only apply on startup; the running world keeps its cells
+    std::optional<world_def> world {load_elements(ELEMENTS_SCRIPT)};
+    if (!world || world->Elements.empty()) { return; } // script error or partially written file
+
+    // keep the selected element if it still exists
+    std::string const selected {_leftBtnElement < static_cast<i32>(_world.Elements.size()) ? _world.Elements[static_cast<usize>(_leftBtnElement)].Name : ""};
+    _world.Elements = std::move(world->Elements);
+    _leftBtnElement = std::max(_world.find_element(selected), 0);
+    _spawnElement   = 0;
+
+    // applied between two ticks
+    _entity->simulation().post([elements = _world.Elements](element_system& system) { system.reload(elements); });
+
+    create_form();
+    if (_formNode) { _formNode->Entity = _form; }
 }
 
 ////////////////////////////////////////////////////////////
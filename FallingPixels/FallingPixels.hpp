@@ -7,20 +7,21 @@
 
 #include "Common.hpp" // IWYU pragma: keep
 
-#include "ElementSystem.hpp"
+#include <filesystem>
+
+#include "ElementScript.hpp"
+#include "Simulation.hpp"
 #include "UI.hpp"
 
 ////////////////////////////////////////////////////////////
 
 class elements_entity : public gfx::entity { // TODO: rename
 public:
-    elements_entity(std::vector<element_def> const& elementsDefs);
-
-    bool DrawHeatMap {false};
+    elements_entity(std::vector<element_def> const& elementsDefs, size_i gridSize, u64 seed);
 
-    auto system() const -> element_system&
+    auto simulation() const -> ::simulation&
     {
-        return *_elementSystem;
+        return *_simulation;
     }
 
     void center_camera(gfx::camera& cam) const
@@ -42,23 +43,21 @@ protected:
     }
 
 private:
-    void update_image();
-
-    stopwatch _hourGlass0;
+    void update_image(sim_frame const& frame);
 
     gfx::shape_batch _layer0;
 
     asset_owner_ptr<gfx::material> _sandMat;
     asset_owner_ptr<gfx::texture>  _sandTex;
 
-    std::shared_ptr<element_system> _elementSystem;
-    gfx::rect_shape*                _shape {nullptr};
+    std::unique_ptr<::simulation> _simulation;
+    std::vector<color>            _uploadBuffer;
+    bool                          _textureIsHeatmap {false};
+    gfx::rect_shape*              _shape {nullptr};
 };
 
 ////////////////////////////////////////////////////////////
 
-using script_element_vec = std::vector<std::tuple<u16, std::string, table>>;
-
 class main_scene : public scene {
 public:
     main_scene(game& game);
@@ -80,16 +79,21 @@ protected:
     void on_mouse_wheel(input::mouse::wheel_event const& ev) override;
 
 private:
-    auto load_script() -> script_element_vec;
-
-    script                                            _script;
-    std::vector<scripting::native_closure_shared_ptr> _funcs;
+    void create_form();
+    void reload_elements();
 
     i32                  _spawnElement {0};
     i32                  _leftBtnElement {0};
     input::mouse::button _mouseDown {input::mouse::button::None};
     i32                  _zoomStage {1};
+    i32                  _tickRateStage {1};
+    bool                 _showProfiler {false};
+    bool                 _recording {false};
+
+    world_def                       _world;
+    std::filesystem::file_time_type _worldWriteTime {};
 
     std::shared_ptr<elements_form>   _form;
+    scene_node*                      _formNode {nullptr};
     std::shared_ptr<elements_entity> _entity;
 };
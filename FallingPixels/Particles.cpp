@@ -0,0 +1,61 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "Particles.hpp"
+
+particle_pool::particle_pool()
+    : PositionX(Capacity)
+    , PositionY(Capacity)
+    , VelocityX(Capacity)
+    , VelocityY(Capacity)
+    , ID(Capacity)
+    , Variation(Capacity)
+    , Temperature(Capacity)
+    , Landing(Capacity)
+    , Landed(Capacity)
+{
+}
+
+auto particle_pool::spawn(point_f pos, point_f vel, u16 id, u8 variation, f32 temperature) -> bool
+{
+    if (_count == Capacity) { return false; }
+
+    usize const idx {_count++};
+    PositionX[idx]   = pos.X;
+    PositionY[idx]   = pos.Y;
+    VelocityX[idx]   = vel.X;
+    VelocityY[idx]   = vel.Y;
+    ID[idx]          = id;
+    Variation[idx]   = variation;
+    Temperature[idx] = temperature;
+    Landed[idx]      = 0;
+    return true;
+}
+
+void particle_pool::retire(usize idx)
+{
+    usize const last {--_count};
+    if (idx == last) { return; }
+
+    PositionX[idx]   = PositionX[last];
+    PositionY[idx]   = PositionY[last];
+    VelocityX[idx]   = VelocityX[last];
+    VelocityY[idx]   = VelocityY[last];
+    ID[idx]          = ID[last];
+    Variation[idx]   = Variation[last];
+    Temperature[idx] = Temperature[last];
+    Landing[idx]     = Landing[last];
+    Landed[idx]      = Landed[last];
+}
+
+auto particle_pool::count() const -> usize
+{
+    return _count;
+}
+
+void particle_pool::clear()
+{
+    _count = 0;
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "Common.hpp" // IWYU pragma: keep
+
+////////////////////////////////////////////////////////////
+
+// fixed-capacity structure of arrays; spawning and retiring never allocate
+class particle_pool final {
+public:
+    static constexpr usize Capacity {16384};
+
+    particle_pool();
+
+    std::vector<f32> PositionX;
+    std::vector<f32> PositionY;
+    std::vector<f32> VelocityX;
+    std::vector<f32> VelocityY;
+    std::vector<u16> ID;
+    std::vector<u8>  Variation;
+    std::vector<f32> Temperature;
+
+    // written by the integration pass
+    std::vector<point_i> Landing;
+    std::vector<u8>      Landed;
+
+    auto spawn(point_f pos, point_f vel, u16 id, u8 variation, f32 temperature) -> bool;
+    void retire(usize idx); // moves the last particle into idx
+
+    auto count() const -> usize;
+    void clear();
+
+private:
+    usize _count {0};
+};
@@ -0,0 +1,93 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "Profiler.hpp"
+
+#include <iomanip>
+#include <numeric>
+
+void rolling_histogram::add(f64 val)
+{
+    _samples[_next] = val;
+    _next           = (_next + 1) % Capacity;
+    _count          = std::min(_count + 1, Capacity);
+}
+
+auto rolling_histogram::average() const -> f64
+{
+    if (_count == 0) { return 0; }
+    return std::accumulate(_samples.begin(), _samples.begin() + static_cast<isize>(_count), 0.0) / static_cast<f64>(_count);
+}
+
+auto rolling_histogram::percentile(f64 p) const -> f64
+{
+    if (_count == 0) { return 0; }
+
+    std::array<f64, Capacity> sorted {_samples};
+    auto const                end {sorted.begin() + static_cast<isize>(_count)};
+    auto const                nth {sorted.begin() + static_cast<isize>(std::clamp(p, 0.0, 1.0) * static_cast<f64>(_count - 1))};
+    std::nth_element(sorted.begin(), nth, end);
+    return *nth;
+}
+
+auto rolling_histogram::max() const -> f64
+{
+    if (_count == 0) { return 0; }
+    return *std::max_element(_samples.begin(), _samples.begin() + static_cast<isize>(_count));
+}
+
+////////////////////////////////////////////////////////////
+
+void tick_profiler::add(update_stats const& stats)
+{
+    std::scoped_lock lock {_mutex};
+
+    auto const phase {[&](profile_phase p) -> rolling_histogram& { return _phases[static_cast<usize>(p)]; }};
+    phase(profile_phase::ResetMoved).add(stats.ResetMoved.count());
+    phase(profile_phase::Chunks).add(stats.Chunks.count());
+    phase(profile_phase::Temperature).add(stats.Temperature.count());
+    phase(profile_phase::Grid).add(stats.Grid.count());
+    phase(profile_phase::Particles).add(stats.Particles.count());
+    phase(profile_phase::DirtyRects).add(stats.DirtyRects.count());
+    _tick.add((stats.ResetMoved + stats.Chunks + stats.Temperature + stats.Grid + stats.Particles + stats.DirtyRects).count());
+
+    // passes that didn't run this tick keep their history
+    _workers = 0;
+    for (usize i {0}; i < _imbalance.size(); ++i) {
+        if (stats.Workers[i].Workers == 0) { continue; }
+        _workers = std::max(_workers, stats.Workers[i].Workers);
+        _imbalance[i].add(stats.Workers[i].imbalance());
+    }
+}
+
+void tick_profiler::add(profile_phase phase, milliseconds time)
+{
+    std::scoped_lock lock {_mutex};
+    _phases[static_cast<usize>(phase)].add(time.count());
+}
+
+auto tick_profiler::summary() const -> std::string
+{
+    static constexpr std::array<char const*, static_cast<usize>(profile_phase::Count)> names {
+        {"reset", "chunks", "temp", "grid", "particles", "dirty", "upload"}};
+    static constexpr std::array<char const*, static_cast<usize>(parallel_pass::Count)> passNames {
+        {"temp", "grid", "particles", "draw"}};
+
+    std::scoped_lock lock {_mutex};
+
+    // milliseconds: average/95th percentile
+    std::stringstream stream;
+    stream << std::fixed << std::setprecision(2);
+    stream << "tick:" << _tick.average() << "/" << _tick.percentile(0.95);
+    for (usize i {0}; i < names.size(); ++i) {
+        stream << " " << names[i] << ":" << _phases[i].average() << "/" << _phases[i].percentile(0.95);
+    }
+    // slowest worker / average worker per parallel pass: average/max
+    stream << " | workers:" << _workers << " imbalance";
+    for (usize i {0}; i < passNames.size(); ++i) {
+        stream << " " << passNames[i] << ":" << _imbalance[i].average() << "/" << _imbalance[i].max();
+    }
+    return stream.str();
+}
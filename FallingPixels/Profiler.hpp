@@ -0,0 +1,61 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "Common.hpp" // IWYU pragma: keep
+
+#include <mutex>
+
+#include "ElementSystem.hpp"
+
+////////////////////////////////////////////////////////////
+
+// distribution of the most recent samples
+class rolling_histogram final {
+public:
+    static constexpr usize Capacity {128};
+
+    void add(f64 val);
+
+    auto average() const -> f64;
+    auto percentile(f64 p) const -> f64;
+    auto max() const -> f64;
+
+private:
+    std::array<f64, Capacity> _samples {};
+    usize                     _count {0};
+    usize                     _next {0};
+};
+
+////////////////////////////////////////////////////////////
+
+enum class profile_phase : u8 {
+    ResetMoved,
+    Chunks,
+    Temperature,
+    Grid,
+    Particles,
+    DirtyRects,
+    Upload,
+    Count
+};
+
+// collects update_stats from the simulation thread and upload times from the render thread
+class tick_profiler final {
+public:
+    void add(update_stats const& stats);
+    void add(profile_phase phase, milliseconds time);
+
+    auto summary() const -> std::string;
+
+private:
+    mutable std::mutex _mutex;
+
+    std::array<rolling_histogram, static_cast<usize>(profile_phase::Count)> _phases;
+    rolling_histogram                                                       _tick;
+    std::array<rolling_histogram, static_cast<usize>(parallel_pass::Count)> _imbalance; // slowest worker / average worker
+    i32                                                                     _workers {0};
+};
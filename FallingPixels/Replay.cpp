@@ -0,0 +1,148 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "Replay.hpp"
+
+void apply_event(element_system& system, replay_event const& ev)
+{
+    switch (ev.Action) {
+    case replay_action::Spawn:   system.spawn(ev.Position, ev.Value); break;
+    case replay_action::Explode: system.explode(ev.Position, ev.Value); break;
+    case replay_action::Clear:   system.clear(); break;
+    }
+}
+
+////////////////////////////////////////////////////////////
+// replay format
+//   u32 magic, u16 version, i32 width, i32 height, u64 seed, u64 ticks, u64 hash, u32 event count
+// events, 11 bytes each
+//   u32 ticks since the previous event, u8 action, i16 x, i16 y, u16 value
+
+static constexpr u32 REPLAY_MAGIC {0x52585046}; // "FPXR"
+static constexpr u16 REPLAY_VERSION {1};
+static constexpr i32 MAX_EXPLOSION_RADIUS {MAX_GRID_SIZE.Width}; // explode visits (2r+1)^2 cells
+
+auto replay::load(io::istream& stream) -> bool
+{
+    if (stream.read<u32>() != REPLAY_MAGIC || stream.read<u16>() != REPLAY_VERSION) { return false; }
+
+    GridSize = {stream.read<i32>(), stream.read<i32>()};
+    Seed     = stream.read<u64>();
+    Ticks    = stream.read<u64>();
+    Hash     = stream.read<u64>();
+
+    Events.clear();
+    u32 const count {stream.read<u32>()};
+    u64       tick {0};
+    for (u32 i {0}; i < count; ++i) {
+        if (stream.is_eof()) { return false; }
+
+        replay_event& ev {Events.emplace_back()};
+        tick += stream.read<u32>();
+        ev.Tick     = tick;
+        ev.Action   = static_cast<replay_action>(stream.read<u8>());
+        ev.Position = {stream.read<i16>(), stream.read<i16>()};
+        ev.Value    = stream.read<u16>();
+        if (ev.Action > replay_action::Clear || ev.Tick > Ticks) { return false; }
+        if (ev.Action == replay_action::Explode && ev.Value > MAX_EXPLOSION_RADIUS) { return false; }
+    }
+    return true;
+}
+
+void replay::save(io::ostream& stream) const
+{
+    auto const to_i16 {[](i32 val) { return static_cast<i16>(std::clamp<i32>(val, std::numeric_limits<i16>::min(), std::numeric_limits<i16>::max())); }};
+
+    stream.write(REPLAY_MAGIC);
+    stream.write(REPLAY_VERSION);
+    stream.write(GridSize.Width);
+    stream.write(GridSize.Height);
+    stream.write(Seed);
+    stream.write(Ticks);
+    stream.write(Hash);
+
+    stream.write(static_cast<u32>(Events.size()));
+    u64 tick {0};
+    for (auto const& ev : Events) {
+        stream.write(static_cast<u32>(ev.Tick - tick));
+        stream.write(static_cast<u8>(ev.Action));
+        stream.write(to_i16(ev.Position.X));
+        stream.write(to_i16(ev.Position.Y));
+        stream.write(static_cast<u16>(ev.Value));
+        tick = ev.Tick;
+    }
+}
+
+////////////////////////////////////////////////////////////
+
+auto replay_recorder::is_recording() const -> bool
+{
+    return _replay.has_value();
+}
+
+void replay_recorder::start(element_system& system)
+{
+    system.restart(system.seed());
+    _replay = replay {.GridSize = system.size(), .Seed = system.seed()};
+}
+
+void replay_recorder::record(replay_event const& ev)
+{
+    if (_replay) { _replay->Events.push_back(ev); }
+}
+
+auto replay_recorder::stop(element_system const& system) -> replay
+{
+    replay retValue {_replay.value_or(replay {})};
+    retValue.Ticks = system.tick();
+    retValue.Hash  = system.hash();
+    _replay.reset();
+    return retValue;
+}
+
+////////////////////////////////////////////////////////////
+
+auto replay_player::is_playing() const -> bool
+{
+    return _playing;
+}
+
+auto replay_player::start(element_system& system, replay rep) -> bool
+{
+    if (rep.GridSize != system.size()) { return false; }
+    // element IDs depend on the loaded elements, so they are checked here and not by replay::load
+    if (std::ranges::any_of(rep.Events, [&](replay_event const& ev) {
+            return ev.Action == replay_action::Spawn && static_cast<usize>(ev.Value) >= system.element_count();
+        })) {
+        return false;
+    }
+
+    system.restart(rep.Seed);
+    _replay  = std::move(rep);
+    _next    = 0;
+    _playing = true;
+    _matched = false;
+    return true;
+}
+
+void replay_player::step(element_system& system)
+{
+    if (!_playing) { return; }
+
+    u64 const tick {system.tick()};
+    for (; _next < _replay.Events.size() && _replay.Events[_next].Tick <= tick; ++_next) {
+        apply_event(system, _replay.Events[_next]);
+    }
+
+    if (tick >= _replay.Ticks) {
+        _playing = false;
+        _matched = system.hash() == _replay.Hash;
+    }
+}
+
+auto replay_player::matched() const -> bool
+{
+    return _matched;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "Common.hpp" // IWYU pragma: keep
+
+#include "ElementSystem.hpp"
+
+////////////////////////////////////////////////////////////
+
+enum class replay_action : u8 {
+    Spawn,
+    Explode,
+    Clear
+};
+
+struct replay_event final {
+    u64           Tick {0}; // ticks since the world was restarted
+    replay_action Action {replay_action::Spawn};
+    point_i       Position {point_i::Zero};
+    i32           Value {0}; // element ID or explosion radius
+};
+
+void apply_event(element_system& system, replay_event const& ev);
+
+////////////////////////////////////////////////////////////
+
+// user input of a session, starting from a restarted world
+struct replay final {
+    size_i                    GridSize {size_i::Zero};
+    u64                       Seed {0};
+    u64                       Ticks {0}; // length of the session
+    u64                       Hash {0};  // element_system::hash at the end of the session
+    std::vector<replay_event> Events;
+
+    auto load(io::istream& stream) -> bool;
+    void save(io::ostream& stream) const;
+};
+
+////////////////////////////////////////////////////////////
+
+class replay_recorder final {
+public:
+    auto is_recording() const -> bool;
+
+    void start(element_system& system); // restarts the world
+    void record(replay_event const& ev);
+    auto stop(element_system const& system) -> replay;
+
+private:
+    std::optional<replay> _replay;
+};
+
+////////////////////////////////////////////////////////////
+
+class replay_player final {
+public:
+    auto is_playing() const -> bool;
+
+    // restarts the world with the seed of the replay; fails if grid size or element IDs don't match the world
+    auto start(element_system& system, replay rep) -> bool;
+    // applies the events of the current tick; call before element_system::update
+    void step(element_system& system);
+    // after the last tick: did the world end up the same as when it was recorded
+    auto matched() const -> bool;
+
+private:
+    replay _replay;
+    usize  _next {0};
+    bool   _playing {false};
+    bool   _matched {false};
+};
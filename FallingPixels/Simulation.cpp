@@ -0,0 +1,227 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "Simulation.hpp"
+
+using namespace std::chrono_literals;
+
+simulation::simulation(std::vector<element_def> const& elements, size_i gridSize, u64 seed)
+    : _system {std::make_unique<element_system>(elements, gridSize, seed)}
+{
+    usize const pixelCount {static_cast<usize>(_system->size().area())};
+    usize const chunkCount {static_cast<usize>(_system->info_chunks().second)};
+    for (auto& frame : _frames) {
+        frame.Pixels.resize(pixelCount);
+    }
+    for (auto& dirty : _history) {
+        dirty.resize(chunkCount);
+    }
+    _dirty.resize(chunkCount);
+
+    _thread = std::jthread {[this](std::stop_token const& stop) { run(stop); }};
+}
+
+simulation::~simulation() = default; // _thread is declared last and joins first
+
+auto simulation::size() const -> size_i
+{
+    return _system->size();
+}
+
+void simulation::post(std::function<void(element_system&)> command)
+{
+    std::scoped_lock lock {_commandMutex};
+    _commands.push_back(std::move(command));
+}
+
+auto simulation::acquire_frame() -> sim_frame const*
+{
+    if ((_middleFrame.load(std::memory_order_acquire) & NewFrameBit) == 0) { return nullptr; }
+
+    _frontFrame = _middleFrame.exchange(_frontFrame, std::memory_order_acq_rel) & FrameIndexMask;
+    return &_frames[_frontFrame];
+}
+
+void simulation::release_frame(sim_frame const& frame)
+{
+    _consumedSequence.store(frame.Sequence, std::memory_order_release);
+}
+
+void simulation::input(replay_event const& ev)
+{
+    post([this, ev](element_system& system) {
+        if (_player.is_playing()) { return; } // would make the playback diverge
+
+        replay_event recorded {ev};
+        recorded.Tick = system.tick();
+        _recorder.record(recorded);
+        apply_event(system, recorded);
+    });
+}
+
+void simulation::start_recording()
+{
+    post([this](element_system& system) { _recorder.start(system); });
+}
+
+void simulation::stop_recording(path const& file)
+{
+    post([this, file](element_system& system) {
+        if (!_recorder.is_recording()) { return; }
+
+        io::ofstream stream {file};
+        _recorder.stop(system).save(stream);
+    });
+}
+
+auto simulation::play(path const& file) -> bool
+{
+    replay rep;
+    {
+        io::ifstream stream {file};
+        if (!rep.load(stream)) {
+            post([this](element_system&) { _replayResult = "replay file missing or broken"; });
+            return false;
+        }
+    }
+
+    post([this, rep = std::move(rep)](element_system& system) mutable {
+        _recorder.stop(system);
+        if (!_player.start(system, std::move(rep))) { _replayResult = "replay doesn't match the world"; }
+    });
+    return true;
+}
+
+void simulation::request_info(point_i i)
+{
+    std::scoped_lock lock {_infoMutex};
+    _infoPosition = i;
+}
+
+auto simulation::info() const -> sim_info
+{
+    std::scoped_lock lock {_infoMutex};
+    return _info;
+}
+
+void simulation::run(std::stop_token const& stop)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto nextTick {clock::now()};
+    auto rateStart {clock::now()};
+    i32  rateTicks {0};
+
+    while (!stop.stop_requested()) {
+        if (i32 const tps {TicksPerSecond.load(std::memory_order_relaxed)}; tps != MAX_SPEED) {
+            nextTick += std::chrono::nanoseconds {1'000'000'000 / tps};
+            auto const now {clock::now()};
+            if (nextTick < now - 250ms) { nextTick = now; } // don't try to catch up after a stall
+            std::this_thread::sleep_until(nextTick);
+        } else {
+            nextTick = clock::now();
+        }
+
+        run_commands();
+        if (_player.is_playing()) {
+            _player.step(*_system);
+            if (!_player.is_playing()) { _replayResult = _player.matched() ? "replay matched" : "replay diverged"; }
+        }
+        _system->update();
+        Profiler.add(_system->last_update());
+        publish();
+
+        // info for the window title
+        ++rateTicks;
+        auto const now {clock::now()};
+        f64 const  elapsed {std::chrono::duration<f64> {now - rateStart}.count()};
+
+        std::scoped_lock lock {_infoMutex};
+        if (elapsed >= 1.0) {
+            _info.TicksPerSecond = static_cast<f32>(rateTicks / elapsed);
+            rateTicks            = 0;
+            rateStart            = now;
+        }
+        _info.Name                                     = _system->info_name(_infoPosition);
+        _info.Heat                                     = _system->info_heat(_infoPosition);
+        std::tie(_info.ActiveChunks, _info.ChunkCount) = _system->info_chunks();
+        _info.Replay                                   = _recorder.is_recording() ? "recording"
+                                                         : _player.is_playing()     ? "replaying"
+                                                                                    : _replayResult;
+    }
+}
+
+void simulation::run_commands()
+{
+    std::vector<std::function<void(element_system&)>> commands;
+    {
+        std::scoped_lock lock {_commandMutex};
+        commands.swap(_commands);
+    }
+
+    for (auto const& command : commands) {
+        command(*_system);
+    }
+}
+
+void simulation::publish()
+{
+    ++_sequence;
+    _system->take_render_dirty(_history[_sequence % HistorySize]);
+
+    sim_frame& frame {_frames[_backFrame]};
+    bool const heatmap {Heatmap.load(std::memory_order_relaxed)};
+
+    if (heatmap) {
+        _system->draw_heatmap(frame.Pixels);
+        frame.FullUpload = true;
+    } else {
+        // bring the back frame up to date
+        if (frame.Heatmap || !collect_dirty(frame.Sequence, _dirty)) {
+            rect_i const full {point_i::Zero, _system->size()};
+            _system->draw_elements({&full, 1}, frame.Pixels);
+        } else {
+            std::erase_if(_dirty, [](rect_i const& rect) { return rect.Size.Width == 0; });
+            _system->draw_elements(_dirty, frame.Pixels);
+            _dirty.resize(_history[0].size());
+        }
+        _system->draw_particles(frame.Pixels);
+
+        // everything the renderer hasn't seen yet, merged into spans per chunk row
+        frame.Upload.clear();
+        frame.FullUpload = !collect_dirty(_consumedSequence.load(std::memory_order_acquire), _dirty);
+        if (!frame.FullUpload) {
+            usize const chunksPerRow {static_cast<usize>(_system->size().Width / CHUNK_SIZE)};
+            rect_i      span {rect_i::Zero};
+            for (usize i {0}; i < _dirty.size(); ++i) {
+                if (i % chunksPerRow == 0 || _dirty[i].Size.Width == 0) {
+                    if (span.Size.Width > 0) { frame.Upload.push_back(span); }
+                    span = rect_i::Zero;
+                }
+                span = merge_rects(span, _dirty[i]);
+            }
+            if (span.Size.Width > 0) { frame.Upload.push_back(span); }
+        }
+    }
+
+    frame.Heatmap  = heatmap;
+    frame.Sequence = _sequence;
+    _backFrame     = _middleFrame.exchange(_backFrame | NewFrameBit, std::memory_order_acq_rel) & FrameIndexMask;
+}
+
+auto simulation::collect_dirty(u64 since, std::vector<rect_i>& dst) const -> bool
+{
+    // frames older than the history need a full copy
+    if (since == 0 || _sequence - since >= HistorySize) { return false; }
+
+    std::ranges::fill(dst, rect_i::Zero);
+    for (u64 seq {since + 1}; seq <= _sequence; ++seq) {
+        auto const& dirty {_history[seq % HistorySize]};
+        for (usize i {0}; i < dst.size(); ++i) {
+            dst[i] = merge_rects(dst[i], dirty[i]);
+        }
+    }
+    return true;
+}
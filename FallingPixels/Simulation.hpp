@@ -0,0 +1,107 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "Common.hpp" // IWYU pragma: keep
+
+#include <mutex>
+#include <thread>
+
+#include "ElementSystem.hpp"
+#include "Profiler.hpp"
+#include "Replay.hpp"
+
+////////////////////////////////////////////////////////////
+
+constexpr i32 MAX_SPEED {0}; // ticks per second: as fast as possible
+
+struct sim_frame final {
+    u64  Sequence {0};
+    bool Heatmap {false};
+
+    std::vector<tcob::color> Pixels;      // row-major, grid sized
+    std::vector<rect_i>      Upload;      // regions changed since the frame the renderer consumed last
+    bool                     FullUpload {true};
+};
+
+struct sim_info final {
+    std::string Name;
+    f32         Heat {0};
+    i32         ActiveChunks {0};
+    i32         ChunkCount {0};
+    f32         TicksPerSecond {0};
+    std::string Replay; // recording, replaying or the result of the last playback
+};
+
+////////////////////////////////////////////////////////////
+
+// runs an element_system on its own thread at a fixed tick rate;
+// completed frames are handed to the render thread through a triple buffer
+class simulation final {
+public:
+    simulation(std::vector<element_def> const& elements, size_i gridSize, u64 seed);
+    ~simulation();
+
+    std::atomic<i32>  TicksPerSecond {50};
+    std::atomic<bool> Heatmap {false};
+    tick_profiler     Profiler;
+
+    auto size() const -> size_i;
+
+    void post(std::function<void(element_system&)> command);
+
+    // user input goes through here so it can be recorded; applied on the simulation thread,
+    // ignored while a replay is playing
+    void input(replay_event const& ev);
+    void start_recording();
+    void stop_recording(path const& file);
+    auto play(path const& file) -> bool;
+
+    auto acquire_frame() -> sim_frame const*;
+    void release_frame(sim_frame const& frame);
+
+    void request_info(point_i i);
+    auto info() const -> sim_info;
+
+private:
+    void run(std::stop_token const& stop);
+    void run_commands();
+    void publish();
+
+    auto collect_dirty(u64 since, std::vector<rect_i>& dst) const -> bool;
+
+    static constexpr u8  FrameIndexMask {0x3};
+    static constexpr u8  NewFrameBit {0x4};
+    static constexpr u64 HistorySize {8};
+
+    std::unique_ptr<element_system> _system;
+
+    // triple buffer
+    std::array<sim_frame, 3> _frames;
+    u8                       _backFrame {0};
+    u8                       _frontFrame {1};
+    std::atomic<u8>          _middleFrame {2};
+    std::atomic<u64>         _consumedSequence {0};
+
+    // render dirty rectangles of the last published frames, per chunk
+    std::array<std::vector<rect_i>, HistorySize> _history;
+    u64                                          _sequence {0};
+    std::vector<rect_i>                          _dirty;
+
+    std::mutex                                        _commandMutex;
+    std::vector<std::function<void(element_system&)>> _commands;
+
+    // only used on the simulation thread
+    replay_recorder _recorder;
+    replay_player   _player;
+    std::string     _replayResult;
+
+    mutable std::mutex _infoMutex;
+    point_i            _infoPosition {point_i::Zero};
+    sim_info           _info;
+
+    std::jthread _thread;
+};
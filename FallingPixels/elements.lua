@@ -3,6 +3,12 @@
 -- This software is released under the MIT License.
 -- https://opensource.org/licenses/MIT
 
+world({
+    Width  = 512,
+    Height = 512,
+    Seed   = 12345,
+})
+
 element("Empty", {
     Colors  = { "black" },
     Gravity = 0,
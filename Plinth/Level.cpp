@@ -55,7 +55,7 @@ auto level::is_seen(point_i cell) const -> bool
 
 void level::mark_seen(point_i cell, point_d playerPos)
 {
-    if (!map_t::Size.contains(cell)) { return; }
+    if (!map_t::Size.contains(cell) || _seen[cell]) { return; }
 
     point_d const cellCenter {cell.X + 0.5, cell.Y + 0.5};
     point_d const delta {cellCenter.X - playerPos.X, cellCenter.Y - playerPos.Y};
@@ -24,6 +24,8 @@ struct level_settings {
     i32  FloorTexture {0};
     i32  CeilingTexture {0};
     bool IsSkybox {false};
+
+    auto operator==(level_settings const& other) const -> bool = default;
 };
 
 class level {
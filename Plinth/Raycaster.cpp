@@ -6,7 +6,9 @@
 #include "Raycaster.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <cmath>
+#include <functional>
 
 #include "Common.hpp"
 #include "Level.hpp"
@@ -14,9 +16,9 @@
 #include "TextureCache.hpp"
 #include "Walls.hpp"
 
-static auto is_magenta(u8 const* tex, i32 offset) -> bool
+static auto is_transparent(u32 texel) -> bool
 {
-    return tex[offset + 0] == 0x98 && tex[offset + 1] == 0x00 && tex[offset + 2] == 0x88;
+    return (texel >> 24) == 0;
 }
 
 static auto shade_from_side(hit_side side) -> f64
@@ -29,12 +31,26 @@ static auto shade_from_side(hit_side side) -> f64
     std::unreachable();
 }
 
-static void set_pixel(u32* dst, i32 dstIdx, u8 const* src, i32 srcIdx, f64 darken)
+// fog and brightness are 8.8 fixed point; their product is a light level,
+// which picks one of the 256-entry channel scaling tables
+static constexpr u32 LIGHT_LEVELS {256};
+static constexpr u32 FULL_LIGHT_LEVEL {64}; // leaves the texel unchanged
+static constexpr f64 MAX_BRIGHTNESS {16.0};
+static constexpr f64 FOG_STEPS_PER_UNIT {16.0};
+
+static auto to_brightness(f64 factor) -> u32
+{
+    return static_cast<u32>(std::clamp(factor, 0.0, MAX_BRIGHTNESS) * 256.0);
+}
+
+static auto light_level(u32 fog, u32 brightness) -> u32
 {
-    u8 const r {static_cast<u8>(std::min(src[srcIdx + 0] * darken, 255.0))};
-    u8 const g {static_cast<u8>(std::min(src[srcIdx + 1] * darken, 255.0))};
-    u8 const b {static_cast<u8>(std::min(src[srcIdx + 2] * darken, 255.0))};
-    dst[dstIdx] = (0xFF000000u) | (static_cast<u32>(b) << 16) | (static_cast<u32>(g) << 8) | static_cast<u32>(r);
+    return std::min((fog * brightness) >> 10, LIGHT_LEVELS - 1);
+}
+
+static auto shade(u32 texel, u8 const* scale) -> u32
+{
+    return 0xFF000000u | (static_cast<u32>(scale[(texel >> 16) & 0xFF]) << 16) | (static_cast<u32>(scale[(texel >> 8) & 0xFF]) << 8) | scale[texel & 0xFF];
 }
 
 static auto sprite_facing_index(degree_d spriteFacing, point_d spritePos, point_d cameraPos) -> i32
@@ -54,30 +70,95 @@ raycaster::raycaster(texture_cache& cache, size_i screenSize, f64 projPlaneDist)
     , _screenSize {screenSize}
     , _projPlaneDist {projPlaneDist}
 {
+    _columns.resize(_screenSize.Width);
     _zBuffer.resize(_screenSize.Width);
-    _spriteDepthBuffer.resize(_screenSize.area());
+    _spriteBins.resize(static_cast<usize>((_screenSize.Width + SpriteBinWidth - 1) / SpriteBinWidth));
 }
 
 auto raycaster::draw(level& level, player const& player) -> u32 const*
 {
-    std::ranges::fill(_spriteDepthBuffer, std::numeric_limits<f64>::infinity());
-    f64 const invFogDistance {1.0 / level.Settings.FogDistance};
+    for (auto& word : _visibleCells) { word.store(0, std::memory_order_relaxed); }
+    if (!_shadeSettings || *_shadeSettings != level.Settings) { update_shade_tables(level.Settings); }
+
+    // rays first, then floor and ceiling by rows, then walls and sprites over them by columns
+    project_sprites(level, player);
+
+    auto& tasks {locate_service<task_manager>()};
+    tasks.run_parallel(
+        [&](par_task const& ctx) {
+            cast_columns(level, player, static_cast<i32>(ctx.Start), static_cast<i32>(ctx.End));
+        },
+        _screenSize.Width);
+
+    cache_cell_surfaces(level);
+    tasks.run_parallel(
+        [&](par_task const& ctx) {
+            draw_floor_ceiling_rows(level, player, static_cast<i32>(ctx.Start), static_cast<i32>(ctx.End));
+        },
+        _screenSize.Height);
 
-    locate_service<task_manager>().run_parallel(
+    tasks.run_parallel(
         [&](par_task const& ctx) {
-            draw_columns(level, player, invFogDistance, static_cast<i32>(ctx.Start), static_cast<i32>(ctx.End));
-            draw_sprites(level, player, invFogDistance, static_cast<i32>(ctx.Start), static_cast<i32>(ctx.End));
+            draw_columns(level, player, static_cast<i32>(ctx.Start), static_cast<i32>(ctx.End));
         },
         _screenSize.Width);
 
+    // the level is only written here, once per visible cell
+    for (usize word {0}; word < VisibleWords; ++word) {
+        for (u64 bits {_visibleCells[word].load(std::memory_order_relaxed)}; bits != 0; bits &= bits - 1) {
+            i32 const idx {static_cast<i32>((word * 64) + static_cast<usize>(std::countr_zero(bits)))};
+            level.mark_seen({idx % MAP_WIDTH, idx / MAP_WIDTH}, player.Position);
+        }
+    }
+
     draw_weapon(player);
     draw_hud(player);
 
     return _screen.data();
 }
 
-void raycaster::draw_columns(level& level, player const& player, f64 invFogDistance, i32 columnStart, i32 columnEnd)
+void raycaster::update_shade_tables(level_settings const& settings)
+{
+    _shadeSettings = settings;
+
+    // FOG_STEPS_PER_UNIT buckets per cell; anything farther uses the last bucket
+    f64 const invFogDistance {1.0 / settings.FogDistance};
+    _fogTable.resize(static_cast<usize>(std::ceil(settings.FogDistance * FOG_STEPS_PER_UNIT)) + 1);
+    for (usize i {0}; i < _fogTable.size(); ++i) {
+        f64 const dist {static_cast<f64>(i) / FOG_STEPS_PER_UNIT};
+        _fogTable[i] = static_cast<u16>(std::max(1.0 - (dist * invFogDistance), settings.FogMin) * 256.0);
+    }
+
+    _lightTable.resize(static_cast<usize>(LIGHT_LEVELS) * 256);
+    for (u32 level {0}; level < LIGHT_LEVELS; ++level) {
+        for (u32 c {0}; c < 256; ++c) {
+            _lightTable[(level * 256) + c] = static_cast<u8>(std::min((c * level) / FULL_LIGHT_LEVEL, 255u));
+        }
+    }
+}
+
+auto raycaster::fog(f64 dist) const -> u32
+{
+    f64 const bucket {std::clamp(dist * FOG_STEPS_PER_UNIT, 0.0, static_cast<f64>(_fogTable.size() - 1))};
+    return _fogTable[static_cast<usize>(bucket)];
+}
+
+auto raycaster::light_scale(u32 fog, u32 brightness) const -> u8 const*
 {
+    return _lightTable.data() + (light_level(fog, brightness) * 256);
+}
+
+void raycaster::cast_columns(level const& level, player const& player, i32 columnStart, i32 columnEnd)
+{
+    i32 const    screenCenterY {(_screenSize.Height / 2) + static_cast<i32>(player.BobAmount)};
+    size_i const skySize {_cache.texture_size(level.Settings.CeilingTexture, 0)};
+
+    std::array<u64, VisibleWords> visible {};
+    auto const                    mark_visible {[&visible](point_i const& cell) {
+        usize const idx {static_cast<usize>(cell.X + (cell.Y * MAP_WIDTH))};
+        visible[idx / 64] |= u64 {1} << (idx % 64);
+    }};
+
     auto const get_light {[&](point_i const& cell) -> f64 {
         return std::visit([](auto&& cell) -> f64 {
             if constexpr (requires { cell.Light; }) { return cell.Light; }
@@ -111,18 +192,16 @@ void raycaster::draw_columns(level& level, player const& player, f64 invFogDista
             sideDist.Y = (map.Y + 1.0 - player.Position.Y) * deltaDist.Y;
         }
 
-        wall_hit hitResult {};
-
-        std::array<wall_hit, MAX_TRANSPARENT_WALLS> transparentHits {};
-        i32                                         transparentCount {0};
+        column& col {_columns[x]};
+        col = {};
 
         auto const process_hit {[&](wall_hit const& wallHit, point_i const& cell) {
             wall_hit h {wallHit};
             h.Light = get_light(cell);
             if (h.Transparent) {
-                if (transparentCount < MAX_TRANSPARENT_WALLS) { transparentHits[transparentCount++] = h; }
+                if (col.TransparentCount < MAX_TRANSPARENT_WALLS) { col.Transparent[col.TransparentCount++] = h; }
             } else {
-                hitResult = h;
+                col.Hit = h;
             }
         }};
 
@@ -131,11 +210,11 @@ void raycaster::draw_columns(level& level, player const& player, f64 invFogDista
             auto const intersect {[&](auto&& c) { return c.intersect({map, player.Position, rayDir, sideDist.X < sideDist.Y, 0.0}); }};
             auto const wallHit {std::visit(intersect, level.get_cell(map))};
             if (wallHit.Hit) { process_hit(wallHit, map); }
-            level.mark_seen(map, player.Position);
+            if (map_t::Size.contains(map)) { mark_visible(map); }
         }
 
         // DDA
-        if (!hitResult.Hit) {
+        if (!col.Hit.Hit) {
             bool       side {false};
             auto const intersect {[&](auto&& c) -> wall_hit { return c.intersect({map, player.Position, rayDir, side, !side ? sideDist.X - deltaDist.X : sideDist.Y - deltaDist.Y}); }};
 
@@ -152,31 +231,39 @@ void raycaster::draw_columns(level& level, player const& player, f64 invFogDista
 
                 if (!map_t::Size.contains(map)) { break; }
 
-                level.mark_seen(map, player.Position);
+                mark_visible(map);
 
                 auto const wallHit {std::visit(intersect, level.get_cell(map))};
                 if (wallHit.Hit) {
                     process_hit(wallHit, map);
-                    if (hitResult.Hit) { break; }
+                    if (col.Hit.Hit) { break; }
                 }
             }
         }
 
-        if (!hitResult.Hit) { continue; }
-
-        _zBuffer[x] = hitResult.Distance;
+        if (level.Settings.IsSkybox) {
+            col.SkyTexX = static_cast<i32>(std::fmod((std::atan2(rayDir.Y, rayDir.X) / TAU) + 1.0, 1.0) * skySize.Width) % skySize.Width;
+        }
 
-        draw_floor_ceiling_column(hitResult, level, player, x, rayDir, invFogDistance);
+        if (!col.Hit.Hit) {
+            _zBuffer[x]    = std::numeric_limits<f64>::infinity();
+            col.CeilingEnd = std::clamp(screenCenterY, 0, _screenSize.Height);
+            col.FloorStart = col.CeilingEnd;
+            continue;
+        }
 
-        draw_wall_column(hitResult, level, player, x, invFogDistance, false);
+        i32 const lineHeight {static_cast<i32>(_projPlaneDist / col.Hit.Distance)};
+        _zBuffer[x]    = col.Hit.Distance;
+        col.CeilingEnd = std::clamp((-lineHeight / 2) + screenCenterY, 0, _screenSize.Height);
+        col.FloorStart = std::clamp((lineHeight / 2) + screenCenterY, 0, _screenSize.Height);
+    }
 
-        for (i32 i {transparentCount - 1}; i >= 0; --i) {
-            draw_wall_column(transparentHits[i], level, player, x, invFogDistance, true);
-        }
+    for (usize word {0}; word < VisibleWords; ++word) {
+        if (visible[word] != 0) { _visibleCells[word].fetch_or(visible[word], std::memory_order_relaxed); }
     }
 }
 
-void raycaster::draw_wall_column(wall_hit const& hit, level const& level, player const& player, isize x, f64 invFogDistance, bool transparent)
+void raycaster::draw_wall_column(wall_hit const& hit, level const& level, player const& player, isize x, bool transparent)
 {
     i32 const screenCenterY {(_screenSize.Height / 2) + static_cast<i32>(player.BobAmount)};
     i32 const lineHeight {static_cast<i32>(_projPlaneDist / hit.Distance)};
@@ -189,127 +276,140 @@ void raycaster::draw_wall_column(wall_hit const& hit, level const& level, player
 
     if (drawStart >= drawEnd) { return; }
 
-    auto const* tex {_cache.texture(hit.Texture, 0)};
-    i32 const   texX {static_cast<i32>((1.0 - hit.SegmentT) * static_cast<f64>(WALL_SIZE.Width))};
-    f64 const   texStep {1.0 * WALL_SIZE.Height / lineHeight};
-    f64         texPos {(drawStart - wallTop) * texStep};
-
-    f64 const wallFogFactor {std::max(1.0 - (hit.Distance * invFogDistance), level.Settings.FogMin)};
-    f64 const wallDarkenFactor {shade_from_side(hit.Side) * wallFogFactor * (level.Settings.AmbientLight + hit.Light)};
+    // one texture column, stepped through in 16.16 fixed point
+    i32 const   texX {std::clamp(static_cast<i32>((1.0 - hit.SegmentT) * static_cast<f64>(WALL_SIZE.Width)), 0, WALL_SIZE.Width - 1)};
+    auto const* texColumn {_cache.texture(hit.Texture, 0) + (texX * WALL_SIZE.Height)};
+    u32 const   texStep {static_cast<u32>((WALL_SIZE.Height << 16) / lineHeight)};
+    u32         texPos {static_cast<u32>(drawStart - wallTop) * texStep};
 
-    u32* screenBuf {_screen.data()};
-    for (i32 y {drawStart}; y < drawEnd; y++) {
-        i32 const texY {static_cast<i32>(texPos) & (WALL_SIZE.Height - 1)};
-        texPos += texStep;
-        i32 const srcIdx {(texX + (texY * WALL_SIZE.Width)) * TEXTURE_BPP};
+    u8 const* wallLight {light_scale(fog(hit.Distance), to_brightness(shade_from_side(hit.Side) * (level.Settings.AmbientLight + hit.Light)))};
 
-        if (transparent) {
-            if (is_magenta(tex, srcIdx)) { continue; }
-            isize const depthIndex {x + (static_cast<isize>(y) * _screenSize.Width)};
-            _spriteDepthBuffer[depthIndex] = std::min(_spriteDepthBuffer[depthIndex], hit.Distance);
+    isize const stride {_screenSize.Width};
+    u32*        dst {_screen.data() + x + (drawStart * stride)};
+    if (!transparent) {
+        for (i32 y {drawStart}; y < drawEnd; ++y, dst += stride, texPos += texStep) {
+            *dst = shade(texColumn[(texPos >> 16) & (WALL_SIZE.Height - 1)], wallLight);
         }
-        set_pixel(screenBuf, x + (y * _screenSize.Width), tex, srcIdx, wallDarkenFactor);
+        return;
+    }
+
+    for (i32 y {drawStart}; y < drawEnd; ++y, dst += stride, texPos += texStep) {
+        u32 const texel {texColumn[(texPos >> 16) & (WALL_SIZE.Height - 1)]};
+        if (is_transparent(texel)) { continue; }
+        *dst = shade(texel, wallLight);
     }
 }
 
-void raycaster::draw_floor_ceiling_column(wall_hit const& hit, level const& level, player const& player, isize x, point_d rayDir, f64 invFogDistance)
+void raycaster::cache_cell_surfaces(level const& level)
 {
-    i32 const screenCenterY {(_screenSize.Height / 2) + static_cast<i32>(player.BobAmount)};
-    i32 const lineHeight {static_cast<i32>(_projPlaneDist / hit.Distance)};
-
-    i32 const wallTop {(-lineHeight / 2) + screenCenterY};
-    i32 const wallBottom {(lineHeight / 2) + screenCenterY};
-
-    i32 const ceilingEnd {std::clamp(wallTop, 0, _screenSize.Height)};
-    i32 const floorStart {std::clamp(wallBottom, 0, _screenSize.Height)};
+    for (i32 y {0}; y < MAP_HEIGHT; ++y) {
+        for (i32 x {0}; x < MAP_WIDTH; ++x) {
+            i32 floorTex {level.Settings.FloorTexture};
+            i32 ceilTex {level.Settings.CeilingTexture};
+            f64 light {0.0};
+            std::visit([&](auto&& cell) {
+                if constexpr (requires { cell.FloorTexture; }) {
+                    if (cell.FloorTexture != INVALID_INDEX) { floorTex = cell.FloorTexture; }
+                }
+                if constexpr (requires { cell.CeilingTexture; }) {
+                    if (cell.CeilingTexture != INVALID_INDEX) { ceilTex = cell.CeilingTexture; }
+                }
+                if constexpr (requires { cell.Light; }) {
+                    light = cell.Light;
+                }
+            },
+                       level.get_cell({x, y}));
 
-    point_d const floorWall {player.Position + (rayDir * hit.Distance)};
-    f64 const     invPerpWallDist {1.0 / hit.Distance};
+            _cellSurfaces[{x, y}] = {.Floor      = _cache.texture(floorTex, 0),
+                                     .Ceiling    = _cache.texture(ceilTex, 0),
+                                     .Brightness = to_brightness(level.Settings.AmbientLight + light)};
+        }
+    }
+}
 
+void raycaster::draw_floor_ceiling_rows(level const& level, player const& player, i32 rowStart, i32 rowEnd)
+{
+    i32 const    screenCenterY {(_screenSize.Height / 2) + static_cast<i32>(player.BobAmount)};
     i32 const    fixedCenterY {_screenSize.Height / 2};
-    size_i const texSize {_cache.texture_size(level.Settings.CeilingTexture, 0)};
-    i32 const    skyTexX {level.Settings.IsSkybox ? static_cast<i32>(std::fmod((std::atan2(rayDir.Y, rayDir.X) / TAU) + 1.0, 1.0) * texSize.Width) % texSize.Width : 0};
-    auto const*  skyTex {level.Settings.IsSkybox ? _cache.texture(level.Settings.CeilingTexture, 0) : nullptr};
-
-    point_i     lastFloorCell {-1, -1};
-    i32         cellFloorTex {level.Settings.FloorTexture};
-    i32         cellCeilTex {level.Settings.CeilingTexture};
-    f64         cellLight {0.0};
-    auto const* cellFloorTexPtr {_cache.texture(cellFloorTex, 0)};
-    auto const* cellCeilTexPtr {_cache.texture(cellCeilTex, 0)};
-
-    auto const get_cell {[&](auto&& cell) {
-        if constexpr (requires { cell.FloorTexture; }) {
-            if (cell.FloorTexture != INVALID_INDEX) { cellFloorTex = cell.FloorTexture; }
-        }
-        if constexpr (requires { cell.CeilingTexture; }) {
-            if (cell.CeilingTexture != INVALID_INDEX) { cellCeilTex = cell.CeilingTexture; }
-        }
-        if constexpr (requires { cell.Light; }) {
-            cellLight = cell.Light;
+    u32 const*   skyTex {level.Settings.IsSkybox ? _cache.texture(level.Settings.CeilingTexture, 0) : nullptr};
+    size_i const skySize {_cache.texture_size(level.Settings.CeilingTexture, 0)};
+
+    cell_surface const outside {.Floor      = _cache.texture(level.Settings.FloorTexture, 0),
+                                .Ceiling    = _cache.texture(level.Settings.CeilingTexture, 0),
+                                .Brightness = to_brightness(level.Settings.AmbientLight)};
+
+    // rays of the leftmost column and the step to the next column
+    point_d const rayDirLeft {player.Direction - player.Plane};
+    point_d const rayDirStep {player.Plane * (2.0 / _screenSize.Width)};
+
+    for (i32 y {rowStart}; y < rowEnd; ++y) {
+        bool const isFloor {y >= screenCenterY};
+        u32* const row {_screen.data() + (static_cast<isize>(y) * _screenSize.Width)};
+
+        if (!isFloor && skyTex) {
+            i32 const skyTexY {static_cast<i32>(std::min(1.0 - (static_cast<f64>(y - fixedCenterY) / static_cast<f64>(_screenSize.Height - fixedCenterY)), 1.0) * skySize.Height) % skySize.Height};
+            for (i32 x {0}; x < _screenSize.Width; ++x) {
+                column const& col {_columns[x]};
+                if (y < col.CeilingEnd) { row[x] = skyTex[(col.SkyTexX * skySize.Height) + skyTexY] | 0xFF000000u; }
+            }
+            continue;
         }
-    }};
-
-    u32* screenBuf {_screen.data()};
 
-    auto const sample_and_draw {[&](i32 y, bool isFloor) {
+        // a floor row and the ceiling row mirrored at the horizon share one distance
         i32 const effectiveY {isFloor ? y : (2 * screenCenterY) - y};
-        f64 const rowDist {effectiveY == screenCenterY ? std::numeric_limits<f64>::infinity()
-                                                       : _projPlaneDist / ((2.0 * effectiveY) - (2.0 * screenCenterY))};
-        f64 const weight {std::min(rowDist * invPerpWallDist, 1.0)};
-
-        point_d const currentFloor {(weight * floorWall.X) + ((1.0 - weight) * player.Position.X),
-                                    (weight * floorWall.Y) + ((1.0 - weight) * player.Position.Y)};
-
-        point_d const delta {currentFloor.X - player.Position.X, currentFloor.Y - player.Position.Y};
-        f64 const     floorDist {std::sqrt((delta.X * delta.X) + (delta.Y * delta.Y))};
-        f64 const     fogFactor {std::max(1.0 - (floorDist * invFogDistance), level.Settings.FogMin)};
-
-        i32 const texelX {static_cast<i32>(currentFloor.X * WALL_SIZE.Width) & (WALL_SIZE.Width - 1)};
-        i32 const texelY {static_cast<i32>(currentFloor.Y * WALL_SIZE.Height) & (WALL_SIZE.Height - 1)};
-        i32 const texelOffset {(texelX + (texelY * WALL_SIZE.Width)) * TEXTURE_BPP};
-
-        point_i const floorCell {static_cast<i32>(currentFloor.X), static_cast<i32>(currentFloor.Y)};
-        if (floorCell != lastFloorCell) {
-            lastFloorCell = floorCell;
-            cellFloorTex  = level.Settings.FloorTexture;
-            cellCeilTex   = level.Settings.CeilingTexture;
-            cellLight     = 0.0;
-            if (map_t::Size.contains(floorCell)) {
-                std::visit(get_cell, level.get_cell(floorCell));
-            }
-            cellFloorTexPtr = _cache.texture(cellFloorTex, 0);
-            cellCeilTexPtr  = _cache.texture(cellCeilTex, 0);
+        f64 const rowDist {_projPlaneDist / std::max(2.0 * (effectiveY - screenCenterY), 1.0)};
+        u32 const rowFog {fog(rowDist)};
+
+        // rows are contiguous, but every pixel reads a texture picked by its cell and shades through
+        // per-channel table lookups; without gathers only the coordinate stepping would vectorize
+        point_d       world {player.Position + (rayDirLeft * rowDist)};
+        point_d const step {rayDirStep * rowDist};
+        for (i32 x {0}; x < _screenSize.Width; ++x, world += step) {
+            column const& col {_columns[x]};
+            if (isFloor ? y < col.FloorStart : y >= col.CeilingEnd) { continue; }
+
+            point_i const       cell {static_cast<i32>(world.X), static_cast<i32>(world.Y)};
+            cell_surface const& surface {map_t::Size.contains(cell) ? _cellSurfaces[cell] : outside};
+
+            i32 const texelX {static_cast<i32>(world.X * WALL_SIZE.Width) & (WALL_SIZE.Width - 1)};
+            i32 const texelY {static_cast<i32>(world.Y * WALL_SIZE.Height) & (WALL_SIZE.Height - 1)};
+            u32 const texel {(isFloor ? surface.Floor : surface.Ceiling)[(texelX * WALL_SIZE.Height) + texelY]};
+            row[x] = shade(texel, light_scale(rowFog, surface.Brightness));
         }
+    }
+}
 
-        f64 const cellFogFactor {fogFactor * (level.Settings.AmbientLight + cellLight)};
-
-        if (isFloor) {
-            set_pixel(screenBuf, x + (y * _screenSize.Width), cellFloorTexPtr, texelOffset, cellFogFactor);
-        } else if (level.Settings.IsSkybox) {
-            i32 const skyTexY {static_cast<i32>(std::min(1.0 - (static_cast<f64>(y - fixedCenterY) / static_cast<f64>(_screenSize.Height - fixedCenterY)), 1.0) * texSize.Height) % texSize.Height};
-            i32 const skyOffset {(skyTexX + (skyTexY * texSize.Width)) * TEXTURE_BPP};
-            set_pixel(screenBuf, x + (y * _screenSize.Width), skyTex, skyOffset, 1.0);
-        } else {
-            set_pixel(screenBuf, x + (y * _screenSize.Width), cellCeilTexPtr, texelOffset, cellFogFactor);
-        }
-    }};
+void raycaster::draw_columns(level const& level, player const& player, i32 columnStart, i32 columnEnd)
+{
+    for (isize x {columnStart}; x < columnEnd; x++) {
+        column const& col {_columns[x]};
+        if (col.Hit.Hit) { draw_wall_column(col.Hit, level, player, x, false); }
 
-    for (i32 y {floorStart}; y < _screenSize.Height; y++) {
-        sample_and_draw(y, true);
-    }
+        // transparent walls and sprites back to front, so neither needs a depth buffer
+        i32 transparent {col.TransparentCount - 1};
+        for (u32 const idx : _spriteBins[static_cast<usize>(x / SpriteBinWidth)]) {
+            projected_sprite const& spr {_sprites[idx]};
+            if (x < spr.ColumnStart || x >= spr.ColumnEnd || spr.Depth >= _zBuffer[x]) { continue; }
 
-    for (i32 y {0}; y < ceilingEnd; y++) {
-        sample_and_draw(y, false);
+            for (; transparent >= 0 && col.Transparent[transparent].Distance > spr.Depth; --transparent) {
+                draw_wall_column(col.Transparent[transparent], level, player, x, true);
+            }
+            draw_sprite_column(spr, x);
+        }
+        for (; transparent >= 0; --transparent) {
+            draw_wall_column(col.Transparent[transparent], level, player, x, true);
+        }
     }
 }
 
-void raycaster::draw_sprites(level const& level, player const& player, f64 invFogDistance, i32 columnStart, i32 columnEnd)
+void raycaster::project_sprites(level const& level, player const& player)
 {
+    _sprites.clear();
+    for (auto& bin : _spriteBins) { bin.clear(); }
+
     f64 const invDet {1.0 / player.Plane.cross(player.Direction)};
     i32 const screenCenterY {(_screenSize.Height / 2) + static_cast<i32>(player.BobAmount)};
 
-    u32* screenBuf {_screen.data()};
     for (sprite const& spr : level.Sprites) {
         point_d const relPos {spr.Position - player.Position};
 
@@ -321,63 +421,69 @@ void raycaster::draw_sprites(level const& level, player const& player, f64 invFo
         f64 const    scale {_projPlaneDist / transformY};
         size_i const spriteSize {static_cast<i32>(std::abs(scale)) * size_i {spr.Size}};
 
-        i32 const yMinBound {0};
-        i32 const yMaxBound {_screenSize.Height - 1};
-
-        point_i const drawStart {std::max({(-spriteSize.Width / 2) + spriteScreenX, 0, columnStart}),
-                                 std::max((-spriteSize.Height / 2) + screenCenterY, yMinBound)};
-        point_i const drawEnd {std::min({(spriteSize.Width / 2) + spriteScreenX, _screenSize.Width, columnEnd}),
-                               std::min((spriteSize.Height / 2) + screenCenterY, yMaxBound + 1)};
+        point_i const drawStart {std::max((-spriteSize.Width / 2) + spriteScreenX, 0),
+                                 std::max((-spriteSize.Height / 2) + screenCenterY, 0)};
+        point_i const drawEnd {std::min((spriteSize.Width / 2) + spriteScreenX, _screenSize.Width),
+                               std::min((spriteSize.Height / 2) + screenCenterY, _screenSize.Height)};
         if (drawStart.X >= drawEnd.X) { continue; }
         if (drawStart.Y >= drawEnd.Y) { continue; }
 
         i32 const spriteLeft {spriteScreenX - (spriteSize.Width / 2)};
-        i32 const spriteTop {(screenCenterY) - (spriteSize.Height / 2)};
+        i32 const spriteTop {screenCenterY - (spriteSize.Height / 2)};
 
         i32 const facing {sprite_facing_index(spr.Facing, spr.Position, player.Position)};
         assert(facing < 8);
-        auto const*  tex {_cache.texture(spr.Texture, facing)};
         size_i const texSize {_cache.texture_size(spr.Texture, facing)};
+        u32 const    texStepY {static_cast<u32>((texSize.Height << 16) / spriteSize.Height)};
 
-        f64 const texStepY {1.0 * texSize.Height / spriteSize.Height};
-        f64 const texPosYStart {(drawStart.Y - spriteTop) * texStepY};
-
-        f64 spriteLight {0.0};
+        f64 spriteCellLight {0.0};
         std::visit([&](auto&& cell) {
-            if constexpr (requires { cell.Light; }) { spriteLight = cell.Light; }
+            if constexpr (requires { cell.Light; }) { spriteCellLight = cell.Light; }
         },
                    level.get_cell(point_i {spr.Position}));
 
-        f64 const spriteFogFactor {std::max(1.0 - (transformY * invFogDistance), level.Settings.FogMin) * (level.Settings.AmbientLight + spriteLight)};
-
-        for (i32 stripe {drawStart.X}; stripe < drawEnd.X; ++stripe) {
-            i32 const texX {((stripe - spriteLeft) * texSize.Width) / spriteSize.Width};
-
-            if (transformY >= _zBuffer[stripe]) { continue; }
-
-            f64 texPos {texPosYStart};
-            for (i32 y {drawStart.Y}; y < drawEnd.Y; ++y) {
-                i32 const texY {static_cast<i32>(texPos) & (texSize.Height - 1)};
-                texPos += texStepY;
-
-                i32 const texOffset {(texX + (texY * texSize.Width)) * TEXTURE_BPP};
-                if (is_magenta(tex, texOffset)) { continue; }
+        _sprites.push_back({.Depth       = transformY,
+                            .Left        = spriteLeft,
+                            .Width       = spriteSize.Width,
+                            .ColumnStart = drawStart.X,
+                            .ColumnEnd   = drawEnd.X,
+                            .RowStart    = drawStart.Y,
+                            .RowEnd      = drawEnd.Y,
+                            .Texture     = _cache.texture(spr.Texture, facing),
+                            .TextureSize = texSize,
+                            .TexPosY     = static_cast<u32>(drawStart.Y - spriteTop) * texStepY,
+                            .TexStepY    = texStepY,
+                            .Light       = light_scale(fog(transformY), to_brightness(level.Settings.AmbientLight + spriteCellLight))});
+    }
 
-                if (y < 0 || y >= _screenSize.Height) { continue; }
+    // stable, so sprites at the same depth keep the level order
+    std::ranges::stable_sort(_sprites, std::ranges::greater {}, &projected_sprite::Depth);
 
-                isize const depthIndex {stripe + (static_cast<isize>(y) * _screenSize.Width)};
-                if (transformY < _spriteDepthBuffer[depthIndex]) {
-                    _spriteDepthBuffer[depthIndex] = transformY;
-                    set_pixel(screenBuf, stripe + (y * _screenSize.Width), tex, texOffset, spriteFogFactor);
-                }
-            }
+    for (u32 idx {0}; idx < _sprites.size(); ++idx) {
+        projected_sprite const& spr {_sprites[idx]};
+        for (i32 bin {spr.ColumnStart / SpriteBinWidth}; bin <= (spr.ColumnEnd - 1) / SpriteBinWidth; ++bin) {
+            _spriteBins[static_cast<usize>(bin)].push_back(idx);
         }
     }
 }
 
+void raycaster::draw_sprite_column(projected_sprite const& spr, isize x)
+{
+    i32 const   texX {static_cast<i32>(((x - spr.Left) * spr.TextureSize.Width) / spr.Width)};
+    u32 const*  texColumn {spr.Texture + (texX * spr.TextureSize.Height)};
+    u32         texPos {spr.TexPosY};
+    isize const stride {_screenSize.Width};
+    u32*        dst {_screen.data() + x + (spr.RowStart * stride)};
+    for (i32 y {spr.RowStart}; y < spr.RowEnd; ++y, dst += stride, texPos += spr.TexStepY) {
+        u32 const texel {texColumn[(texPos >> 16) & (spr.TextureSize.Height - 1)]};
+        if (is_transparent(texel)) { continue; }
+        *dst = shade(texel, spr.Light);
+    }
+}
+
 void raycaster::draw_weapon(player const& player)
 {
-    auto* const tex {_cache.texture(handTexture, 0)};
+    auto const* tex {_cache.texture(handTexture, 0)};
     auto const  texSize {_cache.texture_size(handTexture, 0)};
     u32*        screenBuf {_screen.data()};
 
@@ -394,14 +500,14 @@ void raycaster::draw_weapon(player const& player)
         i32 const texY {std::min(texSize.Height - 1, static_cast<i32>(y / scale))};
         for (i32 x {0}; x < drawSize.Width; ++x) {
             i32 const texX {std::min(texSize.Width - 1, static_cast<i32>(x / scale))};
-            i32 const texOffset {(texX + (texY * texSize.Width)) * TEXTURE_BPP};
-            if (is_magenta(tex, texOffset)) { continue; }
+            u32 const texel {tex[(texX * texSize.Height) + texY]};
+            if (is_transparent(texel)) { continue; }
 
             i32 const screenX {x + offset.X};
             i32 const screenY {y + offset.Y};
             if (screenX < 0 || screenX >= _screenSize.Width || screenY < 0 || screenY >= _screenSize.Height) { continue; }
 
-            set_pixel(screenBuf, screenX + (screenY * _screenSize.Width), tex, texOffset, 1.0);
+            screenBuf[screenX + (screenY * _screenSize.Width)] = texel;
         }
     }
 }
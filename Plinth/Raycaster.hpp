@@ -5,9 +5,13 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <optional>
 #include <vector>
 
 #include "Common.hpp"
+#include "Level.hpp"
 #include "Walls.hpp"
 
 class raycaster {
@@ -17,20 +21,76 @@ public:
     auto draw(level& level, player const& player) -> u32 const*;
 
 private:
-    void draw_columns(level& level, player const& player, f64 invFogDistance, i32 columnStart, i32 columnEnd);
+    struct column {
+        wall_hit                                    Hit;
+        std::array<wall_hit, MAX_TRANSPARENT_WALLS> Transparent;
+        i32                                         TransparentCount {0};
 
-    void draw_wall_column(wall_hit const& hit, level const& level, player const& player, isize x, f64 invFogDistance, bool transparent);
-    void draw_floor_ceiling_column(wall_hit const& hit, level const& level, player const& player, isize x, point_d rayDir, f64 invFogDistance);
+        i32 CeilingEnd {0}; // ceiling rows are above, floor rows from FloorStart on
+        i32 FloorStart {0};
+        i32 SkyTexX {0};
+    };
 
-    void draw_sprites(level const& level, player const& player, f64 invFogDistance, i32 columnStart, i32 columnEnd);
+    struct cell_surface {
+        u32 const* Floor {nullptr};
+        u32 const* Ceiling {nullptr};
+        u32        Brightness {0}; // ambient and cell light, 8.8 fixed point
+    };
+
+    // a sprite projected onto the screen, clipped to it
+    struct projected_sprite {
+        f64 Depth {0};
+        i32 Left {0}; // unclipped, for the texture column
+        i32 Width {0};
+        i32 ColumnStart {0};
+        i32 ColumnEnd {0};
+        i32 RowStart {0};
+        i32 RowEnd {0};
+
+        u32 const* Texture {nullptr};
+        size_i     TextureSize {size_i::Zero};
+        u32        TexPosY {0}; // 16.16 fixed point at RowStart
+        u32        TexStepY {0};
+        u8 const*  Light {nullptr};
+    };
+
+    void update_shade_tables(level_settings const& settings);
+    auto fog(f64 dist) const -> u32;
+    auto light_scale(u32 fog, u32 brightness) const -> u8 const*;
+
+    void cast_columns(level const& level, player const& player, i32 columnStart, i32 columnEnd);
+    void cache_cell_surfaces(level const& level);
+
+    void draw_floor_ceiling_rows(level const& level, player const& player, i32 rowStart, i32 rowEnd);
+    void draw_columns(level const& level, player const& player, i32 columnStart, i32 columnEnd);
+    void draw_wall_column(wall_hit const& hit, level const& level, player const& player, isize x, bool transparent);
+
+    void project_sprites(level const& level, player const& player);
+    void draw_sprite_column(projected_sprite const& spr, isize x);
 
     void draw_weapon(player const& player);
     void draw_hud(player const& player);
 
     std::vector<u32> _screen;
 
-    std::vector<f64> _zBuffer;
-    std::vector<f64> _spriteDepthBuffer;
+    std::vector<column> _columns;
+    std::vector<f64>    _zBuffer;
+
+    static_grid<cell_surface, MAP_WIDTH, MAP_HEIGHT> _cellSurfaces;
+
+    // one bit per map cell the rays passed through, or-ed together by the column tasks
+    static constexpr usize                      VisibleWords {((MAP_WIDTH * MAP_HEIGHT) + 63) / 64};
+    std::array<std::atomic<u64>, VisibleWords> _visibleCells {};
+
+    // back to front; each bin lists the sprites overlapping its SpriteBinWidth columns
+    static constexpr i32          SpriteBinWidth {32};
+    std::vector<projected_sprite> _sprites;
+    std::vector<std::vector<u32>> _spriteBins;
+
+    // rebuilt when the level settings change
+    std::optional<level_settings> _shadeSettings;
+    std::vector<u16>              _fogTable;   // 8.8 fixed point, by distance
+    std::vector<u8>               _lightTable; // 256 scaled channel values per light level
 
     texture_cache& _cache;
     size_i         _screenSize;
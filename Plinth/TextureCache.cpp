@@ -7,6 +7,13 @@
 
 #include "Common.hpp"
 
+static constexpr i32 SOURCE_BPP {3}; // images are RGB after the alpha_remover
+
+static auto is_color_key(u8 const* src) -> bool
+{
+    return src[0] == 0x98 && src[1] == 0x00 && src[2] == 0x88;
+}
+
 auto texture_cache::get_entry(i32 idx, i32 variant) const -> texture_entry const&
 {
     auto const& variants {_directory.at(idx)};
@@ -14,7 +21,7 @@ auto texture_cache::get_entry(i32 idx, i32 variant) const -> texture_entry const
     return it != variants.end() ? it->second : variants.at(0);
 }
 
-auto texture_cache::texture(i32 idx, i32 variant) -> u8*
+auto texture_cache::texture(i32 idx, i32 variant) const -> u32 const*
 {
     return _textures.data() + get_entry(idx, variant).Offset;
 }
@@ -63,23 +70,28 @@ void texture_cache::load()
     };
     // PLACEHOLDER END
 
-    usize totalBytes {0};
+    usize totalTexels {0};
     for (auto const& l : loads) {
-        _directory[l.Tex][l.Variant].Offset = totalBytes;
+        _directory[l.Tex][l.Variant].Offset = totalTexels;
         auto const size {gfx::image::LoadInfo(l.Path)->Size};
         _directory[l.Tex][l.Variant].Size = size;
-        totalBytes += size.area() * TEXTURE_BPP;
+        totalTexels += size.area();
     }
-    _textures.resize(totalBytes);
+    _textures.resize(totalTexels);
 
     for (auto const& l : loads) {
         auto img {gfx::image::Load(l.Path).value()};
         img = gfx::filters::alpha_remover {}(img);
 
-        u8* const   dst {texture(l.Tex, l.Variant)};
-        isize const byteCount {img.info().Size.area() * TEXTURE_BPP};
-        for (isize idx {0}; idx < byteCount; ++idx) {
-            dst[idx] = img.ptr()[idx];
+        size_i const size {img.info().Size};
+        u32* const   dst {_textures.data() + get_entry(l.Tex, l.Variant).Offset};
+        u8 const*    src {img.ptr()};
+        for (i32 y {0}; y < size.Height; ++y) {
+            for (i32 x {0}; x < size.Width; ++x, src += SOURCE_BPP) {
+                dst[(x * size.Height) + y] = is_color_key(src)
+                    ? 0u
+                    : 0xFF000000u | (static_cast<u32>(src[2]) << 16) | (static_cast<u32>(src[1]) << 8) | static_cast<u32>(src[0]);
+            }
         }
     }
 }
@@ -18,9 +18,12 @@ inline constexpr i32 handTexture {666};
 
 ////////////////////////////////////////////////////////////
 
+// textures are stored as packed 32-bit texels in the screen's byte order, column-major:
+// texel (x, y) is at x * height + y, so wall and sprite columns are read sequentially;
+// the magenta color key is turned into texels with zero alpha
 class texture_cache final {
 public:
-    auto texture(i32 idx, i32 variant) -> u8*;
+    auto texture(i32 idx, i32 variant) const -> u32 const*;
     auto texture_size(i32 idx, i32 variant) const -> size_i;
 
     void load();
@@ -33,7 +36,7 @@ private:
 
     auto get_entry(i32 idx, i32 variant) const -> texture_entry const&;
 
-    std::vector<u8> _textures;
+    std::vector<u32> _textures;
 
     std::unordered_map<i32, std::unordered_map<i32, texture_entry>> _directory {};
 };